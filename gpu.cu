@@ -0,0 +1,198 @@
+// optional CUDA backend of BulkSearch(), see gpu.h; build: nvcc -O2 -std=c++17 -c gpu.cu
+#include "gpu.h"
+
+#include <cuda_runtime.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace gpu {
+
+namespace {
+
+constexpr int sigma = 256;
+constexpr int maxGroups = 16; //64-bit words of packed patterns
+constexpr int segment = 1024; //end positions per thread
+constexpr int threads = 256; //per CUDA block
+
+// multi-pattern Shift-Or: the patterns lie side by side in 64-bit words, bit j of a word is 0 while
+// the pattern prefix up to j matches the text ending here; a pattern's first bit is cleared after
+// every shift so that it never inherits the last bit of its neighbor
+__constant__ uint64_t masks[maxGroups][sigma]; //bit j is 0 iff byte c matches pattern byte j
+__constant__ uint64_t starts[maxGroups]; //first bit of each pattern
+__constant__ uint64_t ends[maxGroups]; //last bit of each pattern
+
+// thread t owns the ends [t*segment, (t+1)*segment) and warms up on the warmup bytes before them;
+// only ends from `from` on are reported (the bytes before it were carried over from the last block);
+// each CUDA block stages the current group's table in shared memory, so lookups at diverging bytes
+// do not serialize on the constant cache
+__global__ void shiftOr(const unsigned char* text, unsigned n, unsigned from, int groups, unsigned warmup,
+                        uint2* out, unsigned* count, unsigned capacity) {
+    __shared__ uint64_t table[sigma];
+    unsigned long long lo = ((unsigned long long) blockIdx.x * blockDim.x + threadIdx.x) * segment;
+    bool active = lo < n; //idle threads still take part in the table swaps
+    unsigned long long hi = min(lo + segment, (unsigned long long) n);
+    unsigned long long begin = (lo > warmup) ? lo - warmup : 0;
+    unsigned long long report = max(lo, (unsigned long long) from);
+    for (int g = 0; g < groups; ++g) {
+        __syncthreads(); //everyone is done with the previous group
+        for (int c = threadIdx.x; c < sigma; c += blockDim.x) { table[c] = masks[g][c]; }
+        __syncthreads();
+        if (!active) { continue; }
+        uint64_t d = ~0ULL, start = starts[g], end = ends[g];
+        for (unsigned long long i = begin; i < hi; ++i) {
+            d = ((d << 1) & ~start) | table[text[i]];
+            uint64_t done = ~d & end;
+            if (done == 0 || i < report) { continue; }
+            for (; done; done &= done - 1) {
+                unsigned k = atomicAdd(count, 1u);
+                if (k < capacity) { out[k] = make_uint2((unsigned) i, (unsigned) (g * 64 + __ffsll((long long) done) - 1)); }
+            }
+        }
+    }
+}
+
+void check(cudaError_t e, const char* what) {
+    if (e != cudaSuccess) { throw runtime_error(string(what) + ": " + cudaGetErrorString(e)); }
+}
+
+// one of the two buffer sets the blocks alternate between
+struct Slot {
+    cudaStream_t stream = nullptr;
+    unsigned char* host = nullptr; //pinned
+    unsigned char* text = nullptr;
+    uint2* hits = nullptr;
+    uint2* hostHits = nullptr; //pinned
+    unsigned* count = nullptr;
+    unsigned* hostCount = nullptr; //pinned
+    unsigned capacity = 0;
+    long long offset = -1; //text offset of host[0], -1 while idle
+    unsigned length = 0, from = 0;
+};
+
+}
+
+bool available() {
+    int devices = 0;
+    return cudaGetDeviceCount(&devices) == cudaSuccess && devices > 0;
+}
+
+bool fits(const vector<string>& patterns) {
+    int groups = 0, used = 64;
+    for (const string& p : patterns) {
+        if (p.empty() || p.size() > 64) { return false; }
+        if (used + (int) p.size() > 64) { ++groups; used = 0; }
+        used += (int) p.size();
+    }
+    return !patterns.empty() && groups <= maxGroups;
+}
+
+vector<Found> scan(const char* text, size_t n, const vector<string>& patterns, size_t block) {
+    if (!fits(patterns)) { throw runtime_error("patterns do not fit the GPU kernel"); }
+    //pack the patterns, first fit in order
+    vector<array<uint64_t, sigma>> mask;
+    vector<uint64_t> first, last;
+    vector<int> owner; //group*64+bit -> pattern id
+    int used = 64;
+    size_t longest = 0;
+    for (int id = 0; id < (int) patterns.size(); ++id) {
+        const string& p = patterns[id];
+        longest = max(longest, p.size());
+        if (used + (int) p.size() > 64) {
+            mask.emplace_back();
+            mask.back().fill(~0ULL);
+            first.push_back(0);
+            last.push_back(0);
+            owner.resize(mask.size() * 64, -1);
+            used = 0;
+        }
+        int g = (int) mask.size() - 1;
+        for (size_t j = 0; j < p.size(); ++j) { mask[g][(unsigned char) p[j]] &= ~(1ULL << (used + j)); }
+        first[g] |= 1ULL << used;
+        last[g] |= 1ULL << (used + p.size() - 1);
+        owner[g*64 + used + (int) p.size() - 1] = id;
+        used += (int) p.size();
+    }
+    int groups = (int) mask.size();
+    check(cudaMemcpyToSymbol(masks, mask.data(), groups * sizeof(mask[0])), "cudaMemcpyToSymbol");
+    check(cudaMemcpyToSymbol(starts, first.data(), groups * sizeof(uint64_t)), "cudaMemcpyToSymbol");
+    check(cudaMemcpyToSymbol(ends, last.data(), groups * sizeof(uint64_t)), "cudaMemcpyToSymbol");
+
+    unsigned carry = (unsigned) longest - 1; //bytes repeated from the previous block
+    block = max(min(block, (size_t) 1 << 31), (size_t) 1 << 20);
+    vector<Found> found;
+    array<Slot, 2> slots;
+    auto release = [&] {
+        for (Slot& s : slots) {
+            cudaFreeHost(s.host); cudaFreeHost(s.hostHits); cudaFreeHost(s.hostCount);
+            cudaFree(s.text); cudaFree(s.hits); cudaFree(s.count);
+            if (s.stream != nullptr) { cudaStreamDestroy(s.stream); }
+        }
+    };
+    auto reserve = [](Slot& s, unsigned capacity) { //room for that many hits
+        cudaFreeHost(s.hostHits);
+        cudaFree(s.hits);
+        s.hostHits = nullptr;
+        s.hits = nullptr;
+        check(cudaMallocHost(&s.hostHits, capacity * sizeof(uint2)), "cudaMallocHost");
+        check(cudaMalloc(&s.hits, capacity * sizeof(uint2)), "cudaMalloc");
+        s.capacity = capacity;
+    };
+    auto launch = [&](Slot& s) { //everything async on the slot's stream
+        check(cudaMemcpyAsync(s.text, s.host, s.length, cudaMemcpyHostToDevice, s.stream), "cudaMemcpyAsync");
+        check(cudaMemsetAsync(s.count, 0, sizeof(unsigned), s.stream), "cudaMemsetAsync");
+        unsigned workers = (s.length + segment - 1) / segment;
+        shiftOr<<<(workers + threads - 1) / threads, threads, 0, s.stream>>>(s.text, s.length, s.from, groups, carry, s.hits, s.count, s.capacity);
+        check(cudaGetLastError(), "shiftOr");
+        check(cudaMemcpyAsync(s.hostCount, s.count, sizeof(unsigned), cudaMemcpyDeviceToHost, s.stream), "cudaMemcpyAsync");
+    };
+    auto collect = [&](Slot& s) { //waits for the slot and takes its hits
+        check(cudaStreamSynchronize(s.stream), "cudaStreamSynchronize");
+        unsigned count = *s.hostCount;
+        if (count > s.capacity) { //rare: a denser block than planned, rerun it with room for all
+            reserve(s, count);
+            launch(s);
+            check(cudaStreamSynchronize(s.stream), "cudaStreamSynchronize");
+        }
+        check(cudaMemcpyAsync(s.hostHits, s.hits, count * sizeof(uint2), cudaMemcpyDeviceToHost, s.stream), "cudaMemcpyAsync");
+        check(cudaStreamSynchronize(s.stream), "cudaStreamSynchronize");
+        for (unsigned k = 0; k < count; ++k) { found.push_back({s.offset + s.hostHits[k].x, owner[s.hostHits[k].y]}); }
+        s.offset = -1;
+    };
+    try {
+        for (Slot& s : slots) {
+            check(cudaStreamCreateWithFlags(&s.stream, cudaStreamNonBlocking), "cudaStreamCreate");
+            check(cudaMallocHost(&s.host, block + carry), "cudaMallocHost");
+            check(cudaMalloc(&s.text, block + carry), "cudaMalloc");
+            check(cudaMallocHost(&s.hostCount, sizeof(unsigned)), "cudaMallocHost");
+            check(cudaMalloc(&s.count, sizeof(unsigned)), "cudaMalloc");
+            reserve(s, (unsigned) (block / 64)); //one hit per 64 bytes before a rerun is needed
+        }
+        int next = 0;
+        for (size_t at = 0; at < n; at += block) {
+            Slot& s = slots[next];
+            next ^= 1;
+            if (s.offset >= 0) { collect(s); } //the other slot keeps the device busy meanwhile
+            size_t keep = min((size_t) carry, at);
+            s.offset = (long long) (at - keep);
+            s.from = (unsigned) keep;
+            s.length = (unsigned) (keep + min(block, n - at));
+            memcpy(s.host, text + s.offset, s.length); //pages in the next block while the device scans
+            launch(s);
+        }
+        for (int k = 0; k < 2; ++k, next ^= 1) { if (slots[next].offset >= 0) { collect(slots[next]); } }
+    } catch (...) {
+        release();
+        throw;
+    }
+    release();
+    return found;
+}
+
+}
@@ -0,0 +1,29 @@
+// interface of the optional CUDA backend in gpu.cu, used by BulkSearch() in main.cpp when built
+// with -DSTRINGS_GPU (see README); CPU-only builds neither include nor link it
+#ifndef STRINGS_GPU_H
+#define STRINGS_GPU_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace gpu {
+
+// a hit by the offset of its last byte and the pattern id
+struct Found {
+    long long end;
+    int id;
+};
+
+// a CUDA device is present and usable
+bool available();
+// the kernel holds every pattern: each 1..64 bytes, packed into at most 16 64-bit words
+bool fits(const std::vector<std::string>& patterns);
+// multi-pattern Shift-Or over text, in blocks of `block` bytes shipped through two pinned buffers
+// and two streams, so the copy of one block overlaps the scan of the other; hits in no particular
+// order; throws std::runtime_error on any CUDA failure
+std::vector<Found> scan(const char* text, size_t n, const std::vector<std::string>& patterns, size_t block = 64 << 20);
+
+}
+
+#endif
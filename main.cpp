@@ -1,17 +1,73 @@
 #include <iostream>
 #include <utility>
 #include <vector>
+#include <array>
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <iomanip>
+#include <iterator>
+#include <charconv>
+#include <filesystem>
+#include <map>
+#include <regex>
+#include <tuple>
+#include <bitset>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <new>
+#include <cstdlib>
+#include <system_error>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+#ifdef STRINGS_GPU
+#include "gpu.h"
+#endif
+#if defined(STRINGS_STATS) && defined(TRACY_ENABLE)
+#include <tracy/Tracy.hpp>
+#endif
 
 using namespace std;
 
-// the actual/printable alphabet is chars {32:127, 13, 10};
-constexpr int sigma = 128;
-// chars are by default ascii-decoded byte-sized signed ints;
+// the alphabet is every byte value, so UTF-8, NUL and binary data are all valid text/patterns;
+// tables are always indexed by (unsigned char), never by the (possibly signed) char itself
+constexpr int sigma = 256;
+// bytes are hashed as their unsigned value 0..255, pk is the smallest prime above sigma;
 constexpr int pk = 257;
-// the delimiter is char(0)=NUL (std::strings are not NT);
-constexpr int delim = 0;
+
+// byte equivalences of the foldable matchers, which compare fold(a) == fold(b): Exact is the
+// identity, AsciiCase maps A-Z onto a-z and leaves every other byte (UTF-8 included) alone
+struct Exact {
+    static constexpr unsigned char fold(unsigned char c) { return c; }
+};
+struct AsciiCase {
+    static constexpr unsigned char fold(unsigned char c) { return (unsigned char) (c + ((unsigned char) (c - 'A') < 26) * 32); } //branch-free
+};
 
 template <typename T>
 ostream& operator<<(ostream& os, const vector<T>& v) {
@@ -19,22 +75,70 @@ ostream& operator<<(ostream& os, const vector<T>& v) {
     return os;
 }
 
+// a position or length in a text: 64-bit, so texts and files may exceed 2 GiB; signed, so the n-m
+// bounds of the scan loops stay meaningful when m > n
+using Offset = long long;
+
 struct Hit {
-    int start;
-    int length;
+    Offset start;
+    int length; //patterns, and so matches, stay below 2 GiB; see HitLength() for the ones that may not
     float accuracy;
-    Hit(int s, int l, float a = 1.0f) : start(s), length(l), accuracy(a) {};
+    int id; //index of the matched pattern for multi-pattern engines, 0 otherwise
+    Hit(Offset s, int l, float a = 1.0f, int i = 0) : start(s), length(l), accuracy(a), id(i) {};
+};
+
+// the length of the match base[start, end) for engines whose matches can outgrow the pattern
+// (wildcards, collapsed whitespace): throws length_error rather than wrap Hit::length
+inline int HitLength(Offset start, Offset end) {
+    if (end - start > (Offset) numeric_limits<int>::max()) { throw length_error("match of 2 GiB or more"); }
+    return (int) (end - start);
+}
+
+// ranking for sorted output: higher accuracy first, then the earlier and the shorter hit on ties
+inline bool Better(const Hit& a, const Hit& b) {
+    if (a.accuracy != b.accuracy) { return a.accuracy > b.accuracy; }
+    return a.start != b.start ? a.start < b.start : a.length < b.length;
+}
+
+// the top best hits seen so far, in a bounded heap with the worst kept on top:
+// O(log top) per push, O(min(top, hits)) memory, however many hits the scan produces
+class TopHits {
+private:
+    size_t top;
+    vector<Hit> heap;
+public:
+    // reserves a small head start only, so a huge top costs nothing until hits arrive
+    explicit TopHits(size_t t) : top(t) { heap.reserve(min<size_t>(t, 1024)); }
+    bool full() const { return heap.size() >= top; }
+    const Hit& worst() const { return heap.front(); }
+    // later hits lose ties, so once full only a strictly better accuracy gets in
+    bool admits(float accuracy) const { return top > 0 && (!full() || accuracy > worst().accuracy); }
+    void push(const Hit& h) {
+        if (top == 0 || (full() && !Better(h, worst()))) { return; }
+        if (full()) { pop_heap(heap.begin(), heap.end(), Better); heap.pop_back(); }
+        heap.push_back(h);
+        push_heap(heap.begin(), heap.end(), Better);
+    }
+    vector<Hit> take() { //best first
+        sort_heap(heap.begin(), heap.end(), Better);
+        return std::move(heap);
+    }
 };
 
+// a match does not own its text: base and pattern are views into the caller's buffers
+// (std::string, literal, mmapped region, ...), so they must outlive the match and every
+// print of it; e.g. Naive(string("tmp"), y) returns a match dangling past the full-expression
 class Match {
 private:
-    string base;
-    string pattern;
+    string_view base;
+    string_view pattern;
     int indent;
     bool sorted;
     vector<Hit> hits;
 public:
-    Match(string b, string p, vector<Hit> h, bool sorted = false, int indent = 5);
+    // with sorted and top > 0 only the top best hits are kept, selected in O(h + top log top)
+    Match(string_view b, string_view p, vector<Hit> h, bool sorted = false, int indent = 5, size_t top = 0);
+    const vector<Hit>& getHits() const { return hits; }
     friend ostream& operator<<(ostream& os, Match& match);
 };
 
@@ -42,122 +146,4141 @@ ostream &operator<<(ostream &os, Match &m) {
     os << "string = \"" << m.base << "\";\n";
     os << "pattern = \"" << m.pattern << "\", " << m.hits.size() << " hits produced (sorted by " << ((m.sorted) ? "accuracy" : "index") << "): \n";
     for (const Hit& h : m.hits) {
-        int pi = h.start - m.indent;
-        int si = (int) m.base.size() - (h.start + h.length + m.indent);
-        string pre = (pi > 0) ?
-                     "..." + m.base.substr(pi, m.indent) :
-                     m.base.substr(0, m.indent + pi);
-        string suf = (si > 0) ?
-                     m.base.substr(h.start + h.length, m.indent) + "..." :
-                     m.base.substr(m.base.size() - (m.indent + si), m.indent + si);
-        os << "hit (" << h.accuracy * 100 << "%, pos " << h.start << "-" << h.start + h.length - 1 << "): " << pre << "<" << m.base.substr(h.start, h.length) << ">" << suf << "\n";
+        Offset pi = h.start - m.indent;
+        Offset si = (Offset) m.base.size() - (h.start + h.length + m.indent);
+        string_view pre = (pi > 0) ? m.base.substr(pi, m.indent) : m.base.substr(0, m.indent + pi);
+        string_view suf = (si > 0) ?
+                          m.base.substr(h.start + h.length, m.indent) :
+                          m.base.substr(m.base.size() - (m.indent + si), m.indent + si);
+        os << "hit (" << h.accuracy * 100 << "%, pos " << h.start << "-" << h.start + h.length - 1 << "): "
+           << ((pi > 0) ? "..." : "") << pre << "<" << m.base.substr(h.start, h.length) << ">" << suf << ((si > 0) ? "..." : "") << "\n";
     } //kind of done
     return os;
 }
 
-Match::Match(string b, string p, vector<Hit> h, bool sorted, int indent) : base(std::move(b)), pattern(std::move(p)) {
-    if (sorted) sort(h.begin(),h.end(),[](const Hit& a, const Hit& b){
-            return a.accuracy > b.accuracy; //hits sorted based on accuracy
-        });
+Match::Match(string_view b, string_view p, vector<Hit> h, bool sorted, int indent, size_t top) : base(b), pattern(p), hits(std::move(h)) {
+    if (sorted && top > 0 && top < hits.size()) { //hits sorted based on accuracy, only the best few
+        nth_element(hits.begin(), hits.begin() + (long) top, hits.end(), Better);
+        hits.erase(hits.begin() + (long) top, hits.end());
+    }
+    if (sorted) sort(hits.begin(),hits.end(),Better); //hits sorted based on accuracy
     this->sorted = sorted;
     this->indent = indent;
-    hits = h;
 }
 
+// compact hits and fast output start here
+// (for huge result sets: vector<Hit> spends 24 bytes per hit, and printing a Match goes through
+// iostream with four views per hit; both are fine for a demo, neither for grep-style output)
+
+// the hits of one exact pattern, so they share their length and an accuracy of 1: starts are kept
+// as LEB128 deltas (1-2 bytes per hit on text), with the absolute start every `stride` hits for
+// at(); push() in nondecreasing order; computes at() in O(stride), a full pass in O(h)
+class HitStore {
+private:
+    static constexpr size_t stride = 256;
+    struct Anchor {
+        size_t at; //bytes[at] starts the delta of hit k*stride
+        uint64_t before; //start of hit k*stride-1, 0 for k == 0
+    };
+    int m;
+    size_t count = 0;
+    uint64_t last = 0;
+    vector<uint8_t> bytes;
+    vector<Anchor> anchors;
+
+    static uint64_t decode(const uint8_t*& p) {
+        uint64_t v = 0;
+        for (int shift = 0; ; shift += 7) {
+            v |= (uint64_t) (*p & 0x7f) << shift;
+            if ((*p++ & 0x80) == 0) { return v; }
+        }
+    }
+public:
+    explicit HitStore(int length) : m(length) {}
+    void push(uint64_t start) {
+        if (count % stride == 0) { anchors.push_back({bytes.size(), last}); }
+        uint64_t d = start - last;
+        for (; d >= 0x80; d >>= 7) { bytes.push_back((uint8_t) (d | 0x80)); }
+        bytes.push_back((uint8_t) d);
+        last = start;
+        ++count;
+    }
+    size_t size() const { return count; }
+    int length() const { return m; }
+    size_t memory() const { return bytes.capacity() + anchors.capacity() * sizeof(Anchor); }
+    uint64_t at(size_t k) const {
+        const Anchor& a = anchors[k / stride];
+        const uint8_t* p = bytes.data() + a.at;
+        uint64_t s = a.before;
+        for (size_t i = 0; i <= k % stride; ++i) { s += decode(p); }
+        return s;
+    }
+    // forward range over the starts: for (uint64_t s : store)
+    class iterator {
+    private:
+        const uint8_t* p = nullptr;
+        uint64_t s = 0;
+    public:
+        using iterator_category = forward_iterator_tag;
+        using value_type = uint64_t;
+        using difference_type = ptrdiff_t;
+        using pointer = const uint64_t*;
+        using reference = uint64_t;
+        iterator() = default;
+        explicit iterator(const uint8_t* at) : p(at) {}
+        uint64_t operator*() const { const uint8_t* q = p; return s + decode(q); }
+        iterator& operator++() { s += decode(p); return *this; }
+        iterator operator++(int) { iterator old = *this; ++*this; return old; }
+        bool operator==(const iterator& o) const { return p == o.p; }
+        bool operator!=(const iterator& o) const { return p != o.p; }
+    };
+    iterator begin() const { return iterator(bytes.data()); }
+    iterator end() const { return iterator(bytes.data() + bytes.size()); }
+    vector<Hit> hits() const { //back to the general form
+        vector<Hit> h;
+        h.reserve(count);
+        for (uint64_t s : *this) { h.emplace_back((Offset) s, m); }
+        return h;
+    }
+};
+
+// every hit of a CompiledPattern or StaticPattern straight into a HitStore, no Hit is built
+template <typename Searcher>
+HitStore Compact(const Searcher& searcher, string_view base) {
+    HitStore store((int) searcher.view().size());
+    searcher.scan(base, [&](Offset s) { store.push((uint64_t) s); return true; });
+    return store;
+}
+
+// grep-style lines written straight from the base text into one buffer, numbers by to_chars, and
+// handed to write(2) whenever the buffer fills (and on flush() or destruction), so there is no
+// iostream, no temporary and no allocation per line; not thread-safe
+class HitWriter {
+private:
+    int fd;
+    vector<char> buffer;
+    size_t used = 0;
+
+    void put(string_view s) {
+        if (used + s.size() > buffer.size()) {
+            flush();
+            if (s.size() > buffer.size()) { raw(s.data(), s.size()); return; }
+        }
+        memcpy(buffer.data() + used, s.data(), s.size());
+        used += s.size();
+    }
+    void number(uint64_t v) {
+        char digits[20];
+        put(string_view(digits, (size_t) (to_chars(digits, digits + sizeof(digits), v).ptr - digits)));
+    }
+    void raw(const char* p, size_t n) {
+        while (n > 0) {
+            ssize_t w = ::write(fd, p, n);
+            if (w < 0 && errno == EINTR) { continue; }
+            if (w < 0) { throw system_error(errno, generic_category(), "write"); }
+            p += w;
+            n -= (size_t) w;
+        }
+    }
+public:
+    explicit HitWriter(int descriptor = STDOUT_FILENO, size_t bytes = 1 << 16) : fd(descriptor), buffer(max<size_t>(bytes, 64)) {}
+    ~HitWriter() {
+        try { flush(); } catch (const system_error&) {} //a closed pipe, nothing left to tell
+    }
+    HitWriter(const HitWriter&) = delete;
+    HitWriter& operator=(const HitWriter&) = delete;
+    void flush() {
+        raw(buffer.data(), used);
+        used = 0;
+    }
+    // "label:start\n"
+    void offset(string_view label, uint64_t start) {
+        put(label);
+        put(":");
+        number(start);
+        put("\n");
+    }
+    // "label:start:...before<hit>after...\n" with up to context bytes on either side, cut at line
+    // breaks so that every hit stays on one output line
+    void line(string_view label, string_view base, uint64_t start, size_t length, size_t context = 20) {
+        size_t from = start - min<size_t>(start, context), to = min(base.size(), start + length + context);
+        if (auto nl = (const char*) memrchr(base.data() + from, '\n', start - from)) { from = (size_t) (nl - base.data()) + 1; }
+        if (auto nl = (const char*) memchr(base.data() + start + length, '\n', to - start - length)) { to = (size_t) (nl - base.data()); }
+        bool openLeft = from > 0 && base[from-1] != '\n', openRight = to < base.size() && base[to] != '\n';
+        if (!label.empty()) { put(label); put(":"); }
+        number(start);
+        put(openLeft ? ":..." : ":");
+        put(base.substr(from, start - from));
+        put("<");
+        put(base.substr(start, length));
+        put(">");
+        put(base.substr(start + length, to - start - length));
+        put(openRight ? "...\n" : "\n");
+    }
+};
+
+// instrumentation starts here
+// (built with -DSTRINGS_STATS, the matchers count their work per thread and engine, and every scan
+// is timed; otherwise STRINGS_COUNT and STRINGS_TIMER expand to nothing and the hot loops are
+// unchanged; the counters are plain monotonic totals, so stats::prometheus() can be scraped as is)
+namespace stats {
+
+enum class Engine { Naive, RabinKarp, KnuthMorrisPratt, BoyerMoore, Horspool, Sunday, SimdFilter, StaticPattern,
+                    SpaceInsensitive, StreamKnuthMorrisPratt, StreamRabinKarp, IncrementalSearch, KMismatch, KEdit,
+                    AhoCorasick, RabinKarpSet, Wildcard, SuffixArray, FMIndex, size };
+// comparisons: bytes compared one at a time (KMP: one per byte plus one per failure link);
+// shifts/shifted: window shifts taken and their total length; verifications: windows checked
+// in full (KEdit: start recoveries), collisions: those of them with an equal hash but different
+// bytes; the bit-parallel KMismatch/KEdit compare no single bytes, and the indexes read no text
+// linearly: they count scans, bytes, hits and time (SuffixArray also its binary-search comparisons)
+enum class Counter { scans, bytes, hits, comparisons, shifts, shifted, failureLinks, verifications, collisions,
+                     nanoseconds, size };
+constexpr int engines = (int) Engine::size, counters = (int) Counter::size;
+constexpr const char* engineNames[engines] = {"Naive", "RabinKarp", "KnuthMorrisPratt", "BoyerMoore", "Horspool", "Sunday",
+                                              "SimdFilter", "StaticPattern", "SpaceInsensitive", "StreamKnuthMorrisPratt",
+                                              "StreamRabinKarp", "IncrementalSearch", "KMismatch", "KEdit", "AhoCorasick",
+                                              "RabinKarpSet", "Wildcard", "SuffixArray", "FMIndex"};
+constexpr const char* counterNames[counters] = {"scans", "bytes", "hits", "comparisons", "shifts", "shifted",
+                                                "failure_links", "verifications", "collisions", "nanoseconds"};
+
+using Snapshot = array<array<uint64_t, counters>, engines>; //[engine][counter]
+
+// one thread's counters: only that thread writes them, so an update is a relaxed load and store
+// (no locked instruction), and snapshot() can still read them while the thread runs
+struct Table {
+    array<array<atomic<uint64_t>, counters>, engines> value {};
+};
+
+mutex registry;
+vector<const Table*> live;
+Snapshot retired {}; //totals of the threads that have exited
+
+struct Local {
+    Table table;
+    Local() {
+        lock_guard<mutex> lock(registry);
+        live.push_back(&table);
+    }
+    ~Local() { //folds this thread into retired
+        lock_guard<mutex> lock(registry);
+        for (int e = 0; e < engines; ++e) {
+            for (int c = 0; c < counters; ++c) { retired[e][c] += table.value[e][c].load(memory_order_relaxed); }
+        }
+        live.erase(find(live.begin(), live.end(), &table));
+    }
+};
+
+inline void add(Engine e, Counter c, uint64_t n) {
+    thread_local Local local;
+    atomic<uint64_t>& v = local.table.value[(int) e][(int) c];
+    v.store(v.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// totals over all threads, the live and the exited ones
+Snapshot snapshot() {
+    lock_guard<mutex> lock(registry);
+    Snapshot s = retired;
+    for (const Table* t : live) {
+        for (int e = 0; e < engines; ++e) {
+            for (int c = 0; c < counters; ++c) { s[e][c] += t->value[e][c].load(memory_order_relaxed); }
+        }
+    }
+    return s;
+}
+
+// Prometheus text exposition: strings_<counter>_total{engine="..."}, engines without scans are left
+// out, plus the average shift length as a gauge for the engines that shift
+string prometheus() {
+    Snapshot s = snapshot();
+    string out;
+    for (int c = 0; c < counters; ++c) {
+        out += string("# TYPE strings_") + counterNames[c] + "_total counter\n";
+        for (int e = 0; e < engines; ++e) {
+            if (s[e][(int) Counter::scans] == 0) { continue; }
+            out += string("strings_") + counterNames[c] + "_total{engine=\"" + engineNames[e] + "\"} " + to_string(s[e][c]) + "\n";
+        }
+    }
+    out += "# TYPE strings_average_shift gauge\n";
+    for (int e = 0; e < engines; ++e) {
+        uint64_t shifts = s[e][(int) Counter::shifts];
+        if (shifts == 0) { continue; }
+        out += string("strings_average_shift{engine=\"") + engineNames[e] + "\"} " + to_string((double) s[e][(int) Counter::shifted] / shifts) + "\n";
+    }
+    return out;
+}
+
+// counts a scan and its wall time (steady clock) when it goes out of scope; with TRACY_ENABLE it
+// also opens a Tracy zone named after the engine, while perf sees the scan loops by their symbols
+class Timer {
+private:
+    Engine engine;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+public:
+    explicit Timer(Engine e) : engine(e) {}
+    ~Timer() {
+        add(engine, Counter::scans, 1);
+        add(engine, Counter::nanoseconds, (uint64_t) chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+};
+
+}
+
+// STRINGS_COUNT(engine, counter, n) adds n to a counter of the stats::Engine value engine, e.g. the
+// engine member of a policy; STRINGS_TIMER(engine) times the rest of the enclosing scope
+#ifdef STRINGS_STATS
+#define STRINGS_COUNT(engine, counter, n) stats::add(engine, stats::Counter::counter, (uint64_t) (n))
+#ifdef TRACY_ENABLE
+#define STRINGS_TIMER(engine) ZoneScopedN(stats::engineNames[(int) (engine)]); stats::Timer strings_timer(engine)
+#else
+#define STRINGS_TIMER(engine) stats::Timer strings_timer(engine)
+#endif
+#else
+#define STRINGS_COUNT(engine, counter, n) ((void) 0)
+#define STRINGS_TIMER(engine) ((void) 0)
+#endif
+
 // algorithms start here
+// (all of them take views, so no haystack is ever copied; see Match for the lifetime rule)
+// each algorithm keeps its preprocessing in a policy of namespace compiled, built once per pattern
+// and only read afterwards; policy.scan(base, pattern, sink) calls bool sink(Offset start) for every hit,
+// in order, until the sink returns false; callers guarantee 0 < m <= n
 
-// naive:
-// computes in (n-m)*m iterations = O(nm); uses O(1) memory
-Match Naive(const string& base, const string& pattern) {
+// hands h to a visitor returning either void or bool; false means stop
+template <typename Visitor>
+bool Visit(Visitor& visit, const Hit& h) {
+    if constexpr (is_void_v<decltype(visit(h))>) {
+        visit(h);
+        return true;
+    } else {
+        return (bool) visit(h);
+    }
+}
+
+// algo.scan(base, pattern, sink), with the scan, its bytes, hits and time counted for Algo::engine
+// (see instrumentation)
+template <typename Algo, typename Sink>
+void Scan(const Algo& algo, string_view base, string_view pattern, Sink& sink) {
+    STRINGS_TIMER(Algo::engine);
+    STRINGS_COUNT(Algo::engine, bytes, base.size());
+#ifdef STRINGS_STATS
+    auto counted = [&](Offset s) { STRINGS_COUNT(Algo::engine, hits, 1); return sink(s); };
+    algo.scan(base, pattern, counted);
+#else
+    algo.scan(base, pattern, sink);
+#endif
+}
+
+// a pattern preprocessed once for Algo, e.g. CompiledPattern<compiled::BoyerMoore>;
+// immutable after construction, so one instance can be shared by any number of threads,
+// and search() allocates nothing beyond the growth of the hit vector it is given
+template <typename Algo>
+class CompiledPattern {
+private:
+    string pattern;
+    Algo algo;
+public:
+    explicit CompiledPattern(string_view p) : pattern(p), algo(pattern) {}
+    string_view view() const { return pattern; }
+    template <typename Sink>
+    void scan(string_view base, Sink&& sink) const {
+        if (!pattern.empty() && pattern.size() <= base.size()) { Scan(algo, base, string_view(pattern), sink); }
+    }
+    // appends to hits, so a vector reused across calls stops allocating once it is large enough
+    void search(string_view base, vector<Hit>& hits) const {
+        int m = (int) pattern.size();
+        scan(base, [&](Offset s) { hits.emplace_back(s, m); return true; });
+    }
+    // the match views this->pattern, so it must not outlive the compiled pattern
+    Match search(string_view base) const {
+        vector<Hit> hits;
+        search(base, hits);
+        return {base, pattern, std::move(hits)};
+    }
+    // callback delivery: visit(const Hit&) runs as each hit is found, nothing is accumulated;
+    // it may return bool, false stops the scan
+    template <typename Visitor>
+    void forEach(string_view base, Visitor&& visit) const {
+        int m = (int) pattern.size();
+        scan(base, [&](Offset s) { return Visit(visit, Hit(s, m)); });
+    }
+    // lazy forward range over the hits (for (Hit h : p.hits(text))), O(1) memory; every ++ resumes
+    // the scan one byte after the previous hit, so it rescans up to m bytes per hit;
+    // base and *this must outlive the range
+    class HitRange {
+    private:
+        const CompiledPattern* owner;
+        string_view base;
+    public:
+        class iterator {
+        private:
+            const CompiledPattern* owner = nullptr;
+            string_view base;
+            Offset at = -1; //start of the current hit, -1 for end()
+            void seek(Offset from) {
+                Offset f = owner->findFirst(base.substr(from));
+                at = (f < 0) ? -1 : from + f;
+            }
+        public:
+            using iterator_category = forward_iterator_tag;
+            using value_type = Hit;
+            using difference_type = ptrdiff_t;
+            using pointer = const Hit*;
+            using reference = Hit;
+            iterator() = default;
+            iterator(const CompiledPattern* o, string_view b) : owner(o), base(b) { seek(0); }
+            Hit operator*() const { return {at, (int) owner->pattern.size()}; }
+            iterator& operator++() { seek(at + 1); return *this; }
+            iterator operator++(int) { iterator old = *this; ++*this; return old; }
+            bool operator==(const iterator& o) const { return at == o.at; }
+            bool operator!=(const iterator& o) const { return at != o.at; }
+        };
+        HitRange(const CompiledPattern* o, string_view b) : owner(o), base(b) {}
+        iterator begin() const { return {owner, base}; }
+        iterator end() const { return {}; }
+    };
+    HitRange hits(string_view base) const { return {this, base}; }
+    // count-only and early-exit modes: no Hit is built, and the scan stops at the first/k-th hit
+    bool contains(string_view base) const {
+        bool found = false;
+        scan(base, [&](Offset) { found = true; return false; });
+        return found;
+    }
+    size_t count(string_view base) const {
+        size_t c = 0;
+        scan(base, [&](Offset) { ++c; return true; });
+        return c;
+    }
+    Offset findFirst(string_view base) const { //-1 if there is none
+        Offset first = -1;
+        scan(base, [&](Offset s) { first = s; return false; });
+        return first;
+    }
+    void findN(string_view base, size_t k, vector<Hit>& hits) const { //appends at most k hits
+        if (k == 0) { return; }
+        int m = (int) pattern.size();
+        scan(base, [&](Offset s) { hits.emplace_back(s, m); return --k > 0; });
+    }
+};
+
+// bump allocator handed out as a pmr resource: deallocate() is a no-op and reset() rewinds to the
+// start of the block; a request that does not fit gets its own upstream block, and the next reset()
+// merges those into one block of the combined size, so a steady workload stops allocating
+class Arena : public pmr::memory_resource {
+private:
+    unique_ptr<char[]> block;
+    size_t capacity = 0, used = 0;
+    vector<unique_ptr<char[]>> spill; //overflow since the last reset()
+    size_t spilled = 0;
+
+    // aligns the address, not the offset: new char[] only promises __STDCPP_DEFAULT_NEW_ALIGNMENT__
+    void* do_allocate(size_t bytes, size_t align) override {
+        auto base = (uintptr_t) block.get();
+        size_t at = (size_t) (((base + used + align - 1) & ~(uintptr_t) (align - 1)) - base);
+        if (at + bytes <= capacity) {
+            used = at + bytes;
+            return block.get() + at;
+        }
+        spill.emplace_back(new char[bytes + align]);
+        spilled += bytes + align;
+        auto p = (uintptr_t) spill.back().get();
+        return (void*) ((p + align - 1) & ~(uintptr_t) (align - 1));
+    }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const pmr::memory_resource& other) const noexcept override { return this == &other; }
+public:
+    explicit Arena(size_t bytes) : block(new char[bytes]), capacity(bytes) {}
+    void reset() { //everything handed out so far becomes invalid
+        if (spilled > 0) {
+            capacity += spilled;
+            block.reset(new char[capacity]);
+            spill.clear();
+            spilled = 0;
+        }
+        used = 0;
+    }
+};
+
+// per-thread scratch for one-shot searches: the pattern tables come out of its arena and the hits
+// go to one reused vector, so once both have grown to the workload no query reaches malloc;
+// not thread-safe, keep one per thread (ThreadContext())
+class SearchContext {
+private:
+    Arena arena;
     vector<Hit> hits;
-    int n = (int) base.size();
-    int m = (int) pattern.size();
-    for (int i = 0; i < n-m; ++i) { // n-m times
-        if (base.substr(i,m) == pattern) { hits.emplace_back(i, m); }
+public:
+    explicit SearchContext(size_t scratch = 64 << 10) : arena(scratch) {}
+    // starts a query: the previous query's tables and hits are gone
+    pmr::memory_resource* begin() {
+        arena.reset();
+        hits.clear();
+        return &arena;
     }
-    return {base, pattern, hits};
+    vector<Hit>& results() { return hits; }
+};
+
+SearchContext& ThreadContext() {
+    thread_local SearchContext context;
+    return context;
 }
 
-// Rabin-Karp (no fp check):
-// computes in n-m+1 iterations of O(1) = O(n+m); uses O(1) memory
-Match RabinKarp(const string& base, const string& pattern) {
+// builds Algo's tables from scratch for the policies that have any (KnuthMorrisPratt, BoyerMoore)
+template <typename Algo>
+Algo Compile(string_view pattern, pmr::memory_resource* scratch) {
+    if constexpr (is_constructible_v<Algo, string_view, pmr::memory_resource*>) { return Algo(pattern, scratch); }
+    else { return Algo(pattern); }
+}
+
+// one-shot search: preprocess, scan, discard the tables
+template <typename Algo>
+Match SearchWith(string_view base, string_view pattern) {
     vector<Hit> hits;
-    int n = (int) base.size();
     int m = (int) pattern.size();
-    long long int hp = 0, hb = 0, fmult = 1;
-    for (int i = 0; i < m; ++i) { // O(m)
-        hp = hp + pattern[i] * fmult; // += char*pk^i
-        hb = hb + base[i] * fmult; // += char*pk^i
-        fmult = fmult * pk; // pk^(i+1)
-    } //fmult == pk^patternSize
-    for (int i = 0; i < n - m; ++i) { // n-m times
-        if (hb == hp) { hits.emplace_back(i, m); } // O(1)
-        hb = (hb - base[i] + base[i + m] * fmult) / pk;
-        // [strin]g = s*pk^0 + t*pk^1 + ... + n*pk^(m-1) ->
-        // [0trin]g = 0 + t*pk^1 + ... + n*pk^(m-1) ->
-        // [0tring] -> 0 + t*pk^1 + ... + n*pk^(m-1) + g*pk^m ->
-        // [tring] -> t*pk^0 + ... n*pk(m-2) + g^pk(m-1)
+    if (m > 0 && pattern.size() <= base.size()) {
+        auto collect = [&](Offset s) { hits.emplace_back(s, m); return true; };
+        Scan(Algo(pattern), base, pattern, collect);
     }
     return {base, pattern, hits};
 }
 
-// Knuth-Morris-Pratt:
-// computes in m+n+m iterations = O(n+m); uses O(n+m) memory
-Match KnuthMorrisPratt(const string& base, const string& pattern) { //computes in O(n+m) ~ O(n)
-    vector<Hit> hits;
+// one-shot search on ctx: allocation-free once ctx has warmed up; the hits live in ctx until its
+// next query
+template <typename Algo>
+const vector<Hit>& SearchWith(string_view base, string_view pattern, SearchContext& ctx) {
+    pmr::memory_resource* scratch = ctx.begin();
+    vector<Hit>& hits = ctx.results();
     int m = (int) pattern.size();
+    if (m > 0 && pattern.size() <= base.size()) {
+        auto collect = [&](Offset s) { hits.emplace_back(s, m); return true; };
+        Scan(Compile<Algo>(pattern, scratch), base, pattern, collect);
+    }
+    return hits;
+}
+
+namespace compiled {
+
+// naive:
+// computes in (n-m+1)*m iterations = O(nm); uses O(1) memory
+struct Naive {
+    static constexpr stats::Engine engine = stats::Engine::Naive;
+    explicit Naive(string_view) {}
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        for (Offset i = 0; i <= n-m; ++i) { // n-m+1 times
+            STRINGS_COUNT(engine, verifications, 1);
+            if (base.substr(i,m) == pattern && !sink(i)) { return; }
+        }
+    }
+};
+
+}
+
+Match Naive(string_view base, string_view pattern) { return SearchWith<compiled::Naive>(base, pattern); }
+
+// rolling hash arithmetic modulo the Mersenne prime 2^61-1:
+// products fit a 128-bit intermediate and reduce with a shift and an add instead of a division
+namespace mersenne {
+
+constexpr uint64_t mod = (1ULL << 61) - 1;
+
+inline uint64_t reduce(uint64_t x) { //x < 2*mod
+    return (x >= mod) ? x - mod : x;
+}
+inline uint64_t mul(uint64_t a, uint64_t b) {
+    unsigned __int128 x = (unsigned __int128) a * b;
+    return reduce(reduce((uint64_t) (x & mod) + (uint64_t) (x >> 61)));
+}
+inline uint64_t add(uint64_t a, uint64_t b) { return reduce(a + b); }
+inline uint64_t sub(uint64_t a, uint64_t b) { return reduce(a + mod - b); }
+// h(s) = s[0]*pk^(m-1) + ... + s[m-1]*pk^0
+inline uint64_t hash(string_view s) {
+    uint64_t h = 0;
+    for (char c : s) { h = add(mul(h, pk), (unsigned char) c); }
+    return h;
+}
+// pk^(m-1), the weight of the byte leaving the window
+inline uint64_t lead(size_t m) {
+    uint64_t l = 1;
+    for (size_t i = 1; i < m; ++i) { l = mul(l, pk); }
+    return l;
+}
+// [strin]g -> [tring]: drop out*pk^(m-1), shift everything up by pk, add in*pk^0
+inline uint64_t roll(uint64_t h, unsigned char out, unsigned char in, uint64_t lead) {
+    return add(mul(sub(h, mul(out, lead)), pk), in);
+}
+
+}
+
+namespace compiled {
+
+// Rabin-Karp (mod 2^61-1, fp check):
+// computes in n-m+1 iterations of O(1) plus O(m) per hash hit = O(n+m) expected; uses O(1) memory
+struct RabinKarp {
+    static constexpr stats::Engine engine = stats::Engine::RabinKarp;
+    uint64_t hp; //hash of the pattern
+    uint64_t lead; //pk^(m-1)
+    explicit RabinKarp(string_view pattern) : hp(mersenne::hash(pattern)), lead(mersenne::lead(pattern.size())) {} // O(m)
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        uint64_t hb = mersenne::hash(base.substr(0, m)); // O(m)
+        for (Offset i = 0; i <= n - m; ++i) { // n-m+1 times
+            //equal hashes are only candidates (p ~ n/2^61 of a collision), compare to be sure
+            if (hb == hp) {
+                STRINGS_COUNT(engine, verifications, 1);
+                if (base.compare(i, m, pattern) != 0) { STRINGS_COUNT(engine, collisions, 1); }
+                else if (!sink(i)) { return; }
+            }
+            if (i == n - m) { break; } // the last window has nothing to roll in
+            hb = mersenne::roll(hb, base[i], base[i + m], lead); // O(1)
+        }
+    }
+};
+
+// Knuth-Morris-Pratt, bytes compared under Fold:
+// computes in m+n iterations = O(n+m); uses O(m) memory
+template <typename Fold>
+struct KnuthMorrisPrattOf {
+    static constexpr stats::Engine engine = stats::Engine::KnuthMorrisPratt;
+    static constexpr bool folds = !is_same_v<Fold, Exact>;
+    pmr::vector<int> prefix; //failure function of the pattern alone, no composite string
+    pmr::vector<unsigned char> folded; //the folded pattern, so only text bytes are folded in the scan (empty for Exact)
+    explicit KnuthMorrisPrattOf(string_view pattern, pmr::memory_resource* scratch = pmr::get_default_resource())
+        : prefix(pattern.size(), scratch), folded(scratch) {
+        if constexpr (folds) { for (char c : pattern) { folded.push_back(Fold::fold(c)); } }
+        for (int i = 1; i < (int) pattern.size(); ++i) { //m times
+            int j = prefix[i-1];
+            unsigned char c = Fold::fold(pattern[i]);
+            while (j > 0 && c != Fold::fold(pattern[j])) { j = prefix[j-1]; }
+            if (c == Fold::fold(pattern[j])) { ++j; }
+            prefix[i] = j;
+        }
+    }
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        int j = 0; //length of the pattern prefix matched so far
+        for (Offset i = 0; i < n; ++i) { //n times
+            STRINGS_COUNT(engine, comparisons, 1);
+            if constexpr (folds) {
+                unsigned char c = Fold::fold(base[i]);
+                while (j > 0 && c != folded[j]) { STRINGS_COUNT(engine, failureLinks, 1); STRINGS_COUNT(engine, comparisons, 1); j = prefix[j-1]; }
+                if (c == folded[j]) { ++j; }
+            } else {
+                while (j > 0 && base[i] != pattern[j]) { STRINGS_COUNT(engine, failureLinks, 1); STRINGS_COUNT(engine, comparisons, 1); j = prefix[j-1]; }
+                if (base[i] == pattern[j]) { ++j; }
+            }
+            if (j == m) {
+                if (!sink(i-m+1)) { return; }
+                j = prefix[j-1];
+            }
+        }
+    }
+};
+
+// Boyer-Moore (badchar + strong good-suffix heuristics, Galil rule), bytes compared under Fold:
+// computes in sigma+m+O(n) = O(n+m) even on periodic patterns, ~O(n/m) on text; uses O(sigma+m) memory
+template <typename Fold>
+struct BoyerMooreOf {
+    static constexpr stats::Engine engine = stats::Engine::BoyerMoore;
+    array<int, sigma> table; //bad character shifts, by raw byte: every member of a class holds its shift
+    pmr::vector<int> good; //good suffix shifts; good[0] is the period of the pattern
+    explicit BoyerMooreOf(string_view pattern, pmr::memory_resource* scratch = pmr::get_default_resource())
+        : good(pattern.size(), (int) pattern.size(), scratch) {
+        int m = (int) pattern.size();
+        auto same = [&](int a, int b) { return Fold::fold(pattern[a]) == Fold::fold(pattern[b]); };
+        // bad character shift table, preprocessing in O(sigma+m):
+        table.fill(m);
+        for (int i = 0; i < m-1; ++i) { table[Fold::fold(pattern[i])] = m-i-1; }
+        if constexpr (!is_same_v<Fold, Exact>) {
+            for (int c = 0; c < sigma; ++c) { table[c] = table[Fold::fold((unsigned char) c)]; }
+        }
+        if (m == 0) { return; }
+        // suff[i] = length of the longest common suffix of pattern[0..i] and pattern, in O(m):
+        pmr::vector<int> suff (m, scratch);
+        suff[m-1] = m;
+        for (int i = m-2, f = m-1, g = m-1; i >= 0; --i) {
+            if (i > g && suff[i+m-1-f] < i-g) { suff[i] = suff[i+m-1-f]; continue; }
+            g = min(g, i);
+            f = i;
+            while (g >= 0 && same(g, g+m-1-f)) { --g; }
+            suff[i] = f-g;
+        }
+        // good suffix shift table, preprocessing in O(m):
+        for (int i = m-1, j = 0; i >= 0; --i) { //the matched suffix only reoccurs as a pattern prefix
+            if (suff[i] != i+1) { continue; }
+            for (; j < m-1-i; ++j) { if (good[j] == m) { good[j] = m-1-i; } }
+        }
+        for (int i = 0; i <= m-2; ++i) { good[m-1-suff[i]] = m-1-i; } //it reoccurs inside the pattern
+    }
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        //global shift; pattern[0..known) is known to match after a shift by the period (Galil)
+        Offset shift = 0;
+        int known = 0;
+        while (shift <= n-m) {
+            int i = m-1;
+            while (i >= known and Fold::fold(pattern[i]) == Fold::fold(base[i+shift])) { --i; }
+            STRINGS_COUNT(engine, comparisons, (i >= known) ? m-i : m-known);
+            STRINGS_COUNT(engine, shifts, 1);
+            if (i < known) {
+                if (!sink(shift)) { return; }
+                STRINGS_COUNT(engine, shifted, good[0]);
+                shift += good[0];
+                known = m-good[0];
+                continue;
+            }
+            int badchar = table[(unsigned char) base[i+shift]] - (m-1-i);
+            STRINGS_COUNT(engine, shifted, max(good[i], badchar));
+            shift += max(good[i], badchar);
+            known = 0;
+        }
+    }
+};
+
+using KnuthMorrisPratt = KnuthMorrisPrattOf<Exact>;
+using BoyerMoore = BoyerMooreOf<Exact>;
+
+// Boyer-Moore-Horspool:
+// shifts by the bad character table of the byte under the last pattern position only;
+// computes in sigma+m+(n-m)*m = O(nm) worst case, ~O(n/m) on text; uses O(sigma) memory
+struct Horspool {
+    static constexpr stats::Engine engine = stats::Engine::Horspool;
+    array<int, sigma> table;
+    explicit Horspool(string_view pattern) {
+        int m = (int) pattern.size();
+        table.fill(m);
+        for (int i = 0; i < m-1; ++i) { table[(unsigned char) pattern[i]] = m-i-1; }
+    }
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        for (Offset shift = 0; shift <= n-m; shift += table[(unsigned char) base[shift+m-1]]) {
+            STRINGS_COUNT(engine, comparisons, 1);
+            STRINGS_COUNT(engine, shifts, 1);
+            STRINGS_COUNT(engine, shifted, table[(unsigned char) base[shift+m-1]]);
+            if (base[shift+m-1] != pattern[m-1]) { continue; }
+            STRINGS_COUNT(engine, verifications, 1);
+            if (base.compare(shift, m-1, pattern, 0, m-1) == 0 && !sink(shift)) { return; }
+        }
+    }
+};
+
+// Sunday (quick search):
+// shifts by the byte right after the window, so a shift can reach m+1;
+// computes in sigma+m+(n-m)*m = O(nm) worst case, ~O(n/(m+1)) on text; uses O(sigma) memory
+struct Sunday {
+    static constexpr stats::Engine engine = stats::Engine::Sunday;
+    array<int, sigma> table;
+    explicit Sunday(string_view pattern) {
+        int m = (int) pattern.size();
+        table.fill(m+1);
+        for (int i = 0; i < m; ++i) { table[(unsigned char) pattern[i]] = m-i; }
+    }
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        Offset n = (Offset) base.size();
+        int m = (int) pattern.size();
+        for (Offset shift = 0; shift <= n-m; ) {
+            STRINGS_COUNT(engine, verifications, 1);
+            if (base.compare(shift, m, pattern) == 0 && !sink(shift)) { return; }
+            if (shift == n-m) { break; } //no byte after the last window
+            STRINGS_COUNT(engine, shifts, 1);
+            STRINGS_COUNT(engine, shifted, table[(unsigned char) base[shift+m]]);
+            shift += table[(unsigned char) base[shift+m]];
+        }
+    }
+};
+
+}
+
+Match RabinKarp(string_view base, string_view pattern) { return SearchWith<compiled::RabinKarp>(base, pattern); }
+Match KnuthMorrisPratt(string_view base, string_view pattern) { return SearchWith<compiled::KnuthMorrisPratt>(base, pattern); }
+Match BoyerMoore(string_view base, string_view pattern) { return SearchWith<compiled::BoyerMoore>(base, pattern); }
+Match Horspool(string_view base, string_view pattern) { return SearchWith<compiled::Horspool>(base, pattern); }
+Match Sunday(string_view base, string_view pattern) { return SearchWith<compiled::Sunday>(base, pattern); }
+
+// SIMD first/last-byte filter:
+// broadcasts pattern[0] and pattern[m-1], compares W haystack bytes per step at offsets i and i+m-1
+// and memcmp-verifies only the positions where both agree; computes in n/W vector steps plus
+// one memcmp per candidate = O(nm) worst case, ~O(n/W) on text; uses O(1) memory
+// (the widest of AVX-512BW/AVX2/SSE2 or NEON is picked at runtime, with a scalar fallback)
+namespace simd {
+
+// type-erased sink for the runtime-dispatched kernels: emit(ctx, start) returns false to stop
+struct Emit {
+    void* ctx;
+    bool (*emit)(void*, Offset);
+};
+
+// position p survived the filter, check the m-2 bytes in between; false once the sink is done
+template <bool caseless>
+inline bool verify(string_view base, string_view pattern, size_t p, const Emit& out) {
+    size_t m = pattern.size();
+    if (m < 3) { return out.emit(out.ctx, (Offset) p); }
+    if constexpr (caseless) {
+        for (size_t k = 1; k + 1 < m; ++k) { if (AsciiCase::fold(base[p+k]) != AsciiCase::fold(pattern[k])) { return true; } }
+    } else if (memcmp(base.data() + p + 1, pattern.data() + 1, m - 2) != 0) { return true; }
+    return out.emit(out.ctx, (Offset) p);
+}
+
+// scalar fallback, also used for the tail the vector loops leave behind
+template <bool caseless>
+inline void scalar(string_view base, string_view pattern, size_t from, const Emit& out) {
+    size_t n = base.size(), m = pattern.size();
+    const char* s = base.data();
+    if constexpr (caseless) {
+        unsigned char first = AsciiCase::fold(pattern[0]), last = AsciiCase::fold(pattern[m-1]);
+        for (size_t i = from; i + m <= n; ++i) {
+            if (AsciiCase::fold(s[i]) == first && AsciiCase::fold(s[i+m-1]) == last && !verify<caseless>(base, pattern, i, out)) { return; }
+        }
+        return;
+    }
+    for (size_t i = from; i + m <= n; ++i) {
+        const void* f = memchr(s + i, pattern[0], n - m + 1 - i); //libc's own vectorized first-byte scan
+        if (f == nullptr) { return; }
+        i = (size_t) ((const char*) f - s);
+        if (s[i+m-1] == pattern[m-1] && !verify<caseless>(base, pattern, i, out)) { return; }
+    }
+}
+
+// caseless kernels compare (byte | 0x20) against the lowercase pattern byte when that is a letter:
+// exactly its two cases get through, every other pattern byte is compared as it is
+inline unsigned char lower(unsigned char c) { return AsciiCase::fold(c); }
+inline unsigned char caseBit(unsigned char c) { return (unsigned char) ((unsigned char) (AsciiCase::fold(c) - 'a') < 26 ? 0x20 : 0); }
+
+#if defined(__x86_64__) || defined(__i386__)
+template <bool caseless>
+__attribute__((target("avx512f,avx512bw")))
+inline void avx512(string_view base, string_view pattern, const Emit& out) {
+    size_t n = base.size(), m = pattern.size(), i = 0;
+    const __m512i first = _mm512_set1_epi8((char) (caseless ? lower(pattern[0]) : pattern[0]));
+    const __m512i last = _mm512_set1_epi8((char) (caseless ? lower(pattern[m-1]) : pattern[m-1]));
+    const __m512i foldFirst = _mm512_set1_epi8((char) caseBit(pattern[0]));
+    const __m512i foldLast = _mm512_set1_epi8((char) caseBit(pattern[m-1]));
+    for (; i + m - 1 + 64 <= n; i += 64) {
+        __m512i bf = _mm512_loadu_si512((const void*) (base.data() + i));
+        __m512i bl = _mm512_loadu_si512((const void*) (base.data() + i + m - 1));
+        if constexpr (caseless) {
+            bf = _mm512_or_si512(bf, foldFirst);
+            bl = _mm512_or_si512(bl, foldLast);
+        }
+        unsigned long long mask = _mm512_cmpeq_epi8_mask(bf, first) & _mm512_cmpeq_epi8_mask(bl, last);
+        for (; mask; mask &= mask - 1) { if (!verify<caseless>(base, pattern, i + __builtin_ctzll(mask), out)) { return; } }
+    }
+    scalar<caseless>(base, pattern, i, out);
+}
 
-    string s = pattern + char(delim) + base; //composite string; NUL to restrict the prefix
-    int l = (int) s.size();
-    vector<int> prefix (l);
+template <bool caseless>
+__attribute__((target("avx2")))
+inline void avx2(string_view base, string_view pattern, const Emit& out) {
+    size_t n = base.size(), m = pattern.size(), i = 0;
+    const __m256i first = _mm256_set1_epi8((char) (caseless ? lower(pattern[0]) : pattern[0]));
+    const __m256i last = _mm256_set1_epi8((char) (caseless ? lower(pattern[m-1]) : pattern[m-1]));
+    const __m256i foldFirst = _mm256_set1_epi8((char) caseBit(pattern[0]));
+    const __m256i foldLast = _mm256_set1_epi8((char) caseBit(pattern[m-1]));
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i*) (base.data() + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i*) (base.data() + i + m - 1));
+        if constexpr (caseless) {
+            bf = _mm256_or_si256(bf, foldFirst);
+            bl = _mm256_or_si256(bl, foldLast);
+        }
+        auto mask = (unsigned) _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first), _mm256_cmpeq_epi8(bl, last)));
+        for (; mask; mask &= mask - 1) { if (!verify<caseless>(base, pattern, i + __builtin_ctz(mask), out)) { return; } }
+    }
+    scalar<caseless>(base, pattern, i, out);
+}
+
+template <bool caseless>
+__attribute__((target("sse2")))
+inline void sse2(string_view base, string_view pattern, const Emit& out) {
+    size_t n = base.size(), m = pattern.size(), i = 0;
+    const __m128i first = _mm_set1_epi8((char) (caseless ? lower(pattern[0]) : pattern[0]));
+    const __m128i last = _mm_set1_epi8((char) (caseless ? lower(pattern[m-1]) : pattern[m-1]));
+    const __m128i foldFirst = _mm_set1_epi8((char) caseBit(pattern[0]));
+    const __m128i foldLast = _mm_set1_epi8((char) caseBit(pattern[m-1]));
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i*) (base.data() + i));
+        __m128i bl = _mm_loadu_si128((const __m128i*) (base.data() + i + m - 1));
+        if constexpr (caseless) {
+            bf = _mm_or_si128(bf, foldFirst);
+            bl = _mm_or_si128(bl, foldLast);
+        }
+        auto mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
+        for (; mask; mask &= mask - 1) { if (!verify<caseless>(base, pattern, i + __builtin_ctz(mask), out)) { return; } }
+    }
+    scalar<caseless>(base, pattern, i, out);
+}
+#elif defined(__aarch64__)
+template <bool caseless>
+inline void neon(string_view base, string_view pattern, const Emit& out) {
+    size_t n = base.size(), m = pattern.size(), i = 0;
+    const uint8x16_t first = vdupq_n_u8(caseless ? lower(pattern[0]) : (uint8_t) pattern[0]);
+    const uint8x16_t last = vdupq_n_u8(caseless ? lower(pattern[m-1]) : (uint8_t) pattern[m-1]);
+    const uint8x16_t foldFirst = vdupq_n_u8(caseBit(pattern[0]));
+    const uint8x16_t foldLast = vdupq_n_u8(caseBit(pattern[m-1]));
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        uint8x16_t bf = vld1q_u8((const uint8_t*) base.data() + i);
+        uint8x16_t bl = vld1q_u8((const uint8_t*) base.data() + i + m - 1);
+        if constexpr (caseless) {
+            bf = vorrq_u8(bf, foldFirst);
+            bl = vorrq_u8(bl, foldLast);
+        }
+        uint8x16_t eq = vandq_u8(vceqq_u8(bf, first), vceqq_u8(bl, last));
+        //no movemask on NEON: narrow to 4 bits per byte, so lane k owns bits 4k..4k+3
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0) & 0x8888888888888888ULL;
+        for (; mask; mask &= mask - 1) { if (!verify<caseless>(base, pattern, i + (__builtin_ctzll(mask) >> 2), out)) { return; } }
+    }
+    scalar<caseless>(base, pattern, i, out);
+}
+#endif
+
+using Kernel = void (*)(string_view, string_view, const Emit&);
+
+template <bool caseless>
+inline Kernel dispatch() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) { return avx512<caseless>; }
+    if (__builtin_cpu_supports("avx2")) { return avx2<caseless>; }
+    if (__builtin_cpu_supports("sse2")) { return sse2<caseless>; }
+#elif defined(__aarch64__)
+    return neon<caseless>;
+#endif
+    return [](string_view base, string_view pattern, const Emit& out) { scalar<caseless>(base, pattern, 0, out); };
+}
+
+// resolved once per process
+template <bool caseless = false>
+inline Kernel kernel() {
+    static const Kernel k = dispatch<caseless>();
+    return k;
+}
+
+}
+
+namespace compiled {
+
+template <typename Fold>
+struct SimdFilterOf {
+    static constexpr stats::Engine engine = stats::Engine::SimdFilter;
+    explicit SimdFilterOf(string_view) {}
+    template <typename Sink>
+    void scan(string_view base, string_view pattern, Sink& sink) const {
+        simd::Emit out {&sink, [](void* ctx, Offset s) { return (*static_cast<Sink*>(ctx))(s); }};
+        simd::kernel<is_same_v<Fold, AsciiCase>>()(base, pattern, out);
+    }
+};
+
+using SimdFilter = SimdFilterOf<Exact>;
+
+}
+
+Match SimdFilter(string_view base, string_view pattern) { return SearchWith<compiled::SimdFilter>(base, pattern); }
+
+// case-insensitive and normalized matchers start here
+// (the folding is built into the engines, so the original bytes are still read once, in place)
+
+Match CaselessKnuthMorrisPratt(string_view base, string_view pattern) {
+    return SearchWith<compiled::KnuthMorrisPrattOf<AsciiCase>>(base, pattern);
+}
+Match CaselessBoyerMoore(string_view base, string_view pattern) { return SearchWith<compiled::BoyerMooreOf<AsciiCase>>(base, pattern); }
+Match CaselessSimdFilter(string_view base, string_view pattern) { return SearchWith<compiled::SimdFilterOf<AsciiCase>>(base, pattern); }
+
+inline bool IsSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); } //\t \n \v \f \r
 
-    for (int i = 1; i < l; ++i) { //n+m times
-        int j = prefix[i-1];
-        while (j > 0 && s[i] != s[j]) { j = prefix[j-1]; }
-        if (s[i] == s[j]) { ++j; }
-        prefix[i] = j;
-        if (prefix[i] == m) { hits.emplace_back(i-2*m, m); }
+// whitespace-insensitive search: a run of spaces, tabs, line breaks... in the pattern matches any
+// such run in the text, e.g. a phrase wrapped across lines (\r\n included); Knuth-Morris-Pratt
+// over the text with its runs collapsed to one ' ' on the fly, keeping the start offsets of the last
+// m collapsed bytes in a ring, so nothing is copied; a hit ending in whitespace ends on the first
+// byte of that run; computes in O(n+m); uses O(m) memory
+template <typename Fold = Exact>
+Match SpaceInsensitive(string_view base, string_view pattern) {
+    vector<Hit> hits;
+    string collapsed;
+    for (char c : pattern) {
+        if (!IsSpace(c)) { collapsed += c; }
+        else if (collapsed.empty() || collapsed.back() != ' ') { collapsed += ' '; }
+    }
+    Offset n = (Offset) base.size();
+    int m = (int) collapsed.size();
+    if (m == 0) { return {base, pattern, hits}; }
+    STRINGS_TIMER(stats::Engine::SpaceInsensitive);
+    STRINGS_COUNT(stats::Engine::SpaceInsensitive, bytes, n);
+    compiled::KnuthMorrisPrattOf<Fold> kmp(collapsed);
+    vector<Offset> starts (m); //collapsed byte k began at base[starts[k % m]]
+    bool space = false;
+    int j = 0;
+    for (Offset i = 0, k = 0; i < n; ++i) {
+        char c = base[i];
+        if (IsSpace(c)) {
+            if (space) { continue; }
+            space = true;
+            c = ' ';
+        } else { space = false; }
+        starts[k++ % m] = i;
+        unsigned char f = Fold::fold(c);
+        STRINGS_COUNT(stats::Engine::SpaceInsensitive, comparisons, 1);
+        while (j > 0 && f != Fold::fold(collapsed[j])) {
+            STRINGS_COUNT(stats::Engine::SpaceInsensitive, failureLinks, 1);
+            STRINGS_COUNT(stats::Engine::SpaceInsensitive, comparisons, 1);
+            j = kmp.prefix[j-1];
+        }
+        if (f == Fold::fold(collapsed[j])) { ++j; }
+        if (j == m) {
+            STRINGS_COUNT(stats::Engine::SpaceInsensitive, hits, 1);
+            Offset s = starts[(k-m) % m];
+            hits.emplace_back(s, HitLength(s, i+1));
+            j = kmp.prefix[j-1];
+        }
     }
     return {base, pattern, hits};
 }
 
-// Boyer-Moore (badchar heuristic):
-// computes in sigma+m+(n-m)*m = O(nm); uses O(sigma+m) memory
-Match BoyerMoore(const string& base, const string& pattern) {
+// compile-time patterns start here
+// (patterns known at build time, e.g. protocol magic or log markers: the compiler computes the
+// tables, which end up in the read-only segment, and the scan loops run over the constant m, so
+// there is no preprocessing and no allocation at runtime)
+
+// a string literal as a value type, so that it can be a template argument
+template <size_t N>
+struct FixedString {
+    char text[N] {};
+    constexpr FixedString(const char (&s)[N]) { for (size_t i = 0; i < N; ++i) { text[i] = s[i]; } }
+    static constexpr int size() { return (int) N - 1; } //without the terminating NUL
+    constexpr string_view view() const { return {text, N - 1}; }
+};
+
+// Boyer-Moore and Knuth-Morris-Pratt over a fixed pattern, e.g. StaticPattern<"ERROR"> in C++20;
+// C++17 has no class-type template arguments, there it takes a FixedString with static storage:
+// static constexpr FixedString marker("ERROR"); StaticPattern<marker>
+// computes in O(n) with the same shifts as compiled::BoyerMoore; uses no memory beyond the
+// constant tables; stateless, so any number of threads share one
+#if __cpp_nontype_template_args >= 201911L
+template <FixedString P>
+#else
+template <const auto& P>
+#endif
+class StaticPattern {
+private:
+    static constexpr int m = P.size();
+    static_assert(m > 0, "StaticPattern needs a non-empty pattern");
+    struct Tables {
+        int prefix[m] {}; //failure function, as in compiled::KnuthMorrisPratt
+        int good[m] {}; //good suffix shifts, as in compiled::BoyerMoore
+        int badchar[sigma] {};
+    };
+    static constexpr Tables build() {
+        Tables t;
+        const char* p = P.text;
+        for (int i = 1; i < m; ++i) {
+            int j = t.prefix[i-1];
+            while (j > 0 && p[i] != p[j]) { j = t.prefix[j-1]; }
+            if (p[i] == p[j]) { ++j; }
+            t.prefix[i] = j;
+        }
+        for (int c = 0; c < sigma; ++c) { t.badchar[c] = m; }
+        for (int i = 0; i < m-1; ++i) { t.badchar[(unsigned char) p[i]] = m-i-1; }
+        int suff[m] {};
+        suff[m-1] = m;
+        for (int i = m-2, f = m-1, g = m-1; i >= 0; --i) {
+            if (i > g && suff[i+m-1-f] < i-g) { suff[i] = suff[i+m-1-f]; continue; }
+            g = min(g, i);
+            f = i;
+            while (g >= 0 && p[g] == p[g+m-1-f]) { --g; }
+            suff[i] = f-g;
+        }
+        for (int i = 0; i < m; ++i) { t.good[i] = m; }
+        for (int i = m-1, j = 0; i >= 0; --i) {
+            if (suff[i] != i+1) { continue; }
+            for (; j < m-1-i; ++j) { if (t.good[j] == m) { t.good[j] = m-1-i; } }
+        }
+        for (int i = 0; i <= m-2; ++i) { t.good[m-1-suff[i]] = m-1-i; }
+        return t;
+    }
+    static constexpr Tables tables = build();
+public:
+    static constexpr string_view view() { return P.view(); }
+    // bool sink(Offset start) for every hit, in order, until it returns false; the compare loop has
+    // constant bounds and constant bytes, so the compiler may unroll it into immediate compares
+    template <typename Sink>
+    void scan(string_view base, Sink&& sink) const {
+        STRINGS_TIMER(stats::Engine::StaticPattern);
+        STRINGS_COUNT(stats::Engine::StaticPattern, bytes, base.size());
+        Offset n = (Offset) base.size();
+        const char* s = base.data();
+        if (n < m) { return; }
+        if constexpr (m == 1) {
+            for (const char* f = s; (f = (const char*) memchr(f, P.text[0], (size_t) (s + n - f))) != nullptr; ++f) {
+                STRINGS_COUNT(stats::Engine::StaticPattern, hits, 1);
+                if (!sink((Offset) (f - s))) { return; }
+            }
+        } else {
+            Offset shift = 0; //Galil rule, see compiled::BoyerMoore
+            int known = 0;
+            while (shift <= n-m) {
+                int i = m-1;
+                while (i >= known && P.text[i] == s[i+shift]) { --i; }
+                STRINGS_COUNT(stats::Engine::StaticPattern, comparisons, (i >= known) ? m-i : m-known);
+                STRINGS_COUNT(stats::Engine::StaticPattern, shifts, 1);
+                if (i < known) {
+                    STRINGS_COUNT(stats::Engine::StaticPattern, hits, 1);
+                    STRINGS_COUNT(stats::Engine::StaticPattern, shifted, tables.good[0]);
+                    if (!sink(shift)) { return; }
+                    shift += tables.good[0];
+                    known = m-tables.good[0];
+                    continue;
+                }
+                int step = max(tables.good[i], tables.badchar[(unsigned char) s[i+shift]] - (m-1-i));
+                STRINGS_COUNT(stats::Engine::StaticPattern, shifted, step);
+                shift += step;
+                known = 0;
+            }
+        }
+    }
+    // the CompiledPattern interface; the match views the pattern's static storage, so it never dangles
+    void search(string_view base, vector<Hit>& hits) const { scan(base, [&](Offset s) { hits.emplace_back(s, m); return true; }); }
+    Match search(string_view base) const {
+        vector<Hit> hits;
+        search(base, hits);
+        return {base, view(), std::move(hits)};
+    }
+    template <typename Visitor>
+    void forEach(string_view base, Visitor&& visit) const { scan(base, [&](Offset s) { return Visit(visit, Hit(s, m)); }); }
+    bool contains(string_view base) const { return findFirst(base) >= 0; }
+    size_t count(string_view base) const {
+        size_t c = 0;
+        scan(base, [&](Offset) { ++c; return true; });
+        return c;
+    }
+    Offset findFirst(string_view base) const { //-1 if there is none
+        Offset first = -1;
+        scan(base, [&](Offset s) { first = s; return false; });
+        return first;
+    }
+    // streaming Knuth-Morris-Pratt on the constant failure function: visit(const Hit&) gets the
+    // hits ending in each chunk, with absolute offsets, including the ones straddling chunk borders
+    class Stream {
+    private:
+        int j = 0; //length of the pattern prefix matched at the end of the last chunk
+        Offset pos = 0; //absolute offset of the next byte to be fed
+    public:
+        template <typename Visitor>
+        void feed(string_view chunk, Visitor&& visit) {
+            for (char c : chunk) {
+                while (j > 0 && c != P.text[j]) { j = tables.prefix[j-1]; }
+                if (c == P.text[j]) { ++j; }
+                ++pos;
+                if (j == m) { visit(Hit(pos-m, m)); j = tables.prefix[j-1]; }
+            }
+        }
+        void finish() { j = 0; pos = 0; }
+    };
+};
+
+// streaming matchers start here
+// (text arrives chunk by chunk via feed(), hits carry absolute offsets into the whole stream
+// and include the ones straddling chunk borders; state is O(m), independent of the input size)
+
+// streaming Knuth-Morris-Pratt:
+// keeps only the failure function and the matched-prefix length j across chunks
+class StreamKnuthMorrisPratt {
+private:
+    string pattern;
+    pmr::vector<int> prefix; //the failure function of compiled::KnuthMorrisPratt
+    int j = 0; //length of the pattern prefix matched at the end of the last chunk
+    Offset pos = 0; //absolute offset of the next byte to be fed
+public:
+    explicit StreamKnuthMorrisPratt(string_view p) : pattern(p), prefix(compiled::KnuthMorrisPratt(p).prefix) {}
+    // returns the hits ending inside this chunk
+    vector<Hit> feed(string_view chunk) {
+        vector<Hit> hits;
+        int m = (int) pattern.size();
+        if (m == 0) { pos += (Offset) chunk.size(); return hits; }
+        STRINGS_TIMER(stats::Engine::StreamKnuthMorrisPratt);
+        STRINGS_COUNT(stats::Engine::StreamKnuthMorrisPratt, bytes, chunk.size());
+        STRINGS_COUNT(stats::Engine::StreamKnuthMorrisPratt, comparisons, chunk.size());
+        for (char c : chunk) {
+            while (j > 0 && c != pattern[j]) {
+                STRINGS_COUNT(stats::Engine::StreamKnuthMorrisPratt, failureLinks, 1);
+                STRINGS_COUNT(stats::Engine::StreamKnuthMorrisPratt, comparisons, 1);
+                j = prefix[j-1];
+            }
+            if (c == pattern[j]) { ++j; }
+            ++pos;
+            if (j == m) {
+                STRINGS_COUNT(stats::Engine::StreamKnuthMorrisPratt, hits, 1);
+                hits.emplace_back(pos-m, m);
+                j = prefix[j-1];
+            }
+        }
+        return hits;
+    }
+    // ends the stream: every hit was already reported by feed, so this only resets the state
+    vector<Hit> finish() { j = 0; pos = 0; return {}; }
+};
+
+// streaming Rabin-Karp:
+// keeps the rolling hash hb and the last m bytes in a ring, so candidates are verified exactly
+class StreamRabinKarp {
+private:
+    string pattern;
+    string window; //ring of the last m bytes, window[p % m] holds byte p
+    uint64_t hp = 0, hb = 0, lead = 1; //lead == pk^(m-1) mod 2^61-1
+    Offset pos = 0;
+public:
+    explicit StreamRabinKarp(string_view p) : pattern(p), window(p.size(), '\0'),
+                                              hp(mersenne::hash(p)), lead(mersenne::lead(p.size())) {}
+    vector<Hit> feed(string_view chunk) {
+        vector<Hit> hits;
+        Offset m = (Offset) pattern.size();
+        if (m == 0) { pos += (Offset) chunk.size(); return hits; }
+        STRINGS_TIMER(stats::Engine::StreamRabinKarp);
+        STRINGS_COUNT(stats::Engine::StreamRabinKarp, bytes, chunk.size());
+        for (char c : chunk) {
+            char& slot = window[pos % m];
+            //until the window is full nothing leaves it, dropping a 0 byte just accumulates the hash
+            hb = mersenne::roll(hb, (pos >= m) ? slot : '\0', c, lead);
+            slot = c;
+            ++pos;
+            if (pos >= m && hb == hp) {
+                Offset s = pos - m;
+                int k = 0;
+                STRINGS_COUNT(stats::Engine::StreamRabinKarp, verifications, 1);
+                while (k < m && window[(s + k) % m] == pattern[k]) { ++k; } //fp check
+                if (k < m) { STRINGS_COUNT(stats::Engine::StreamRabinKarp, collisions, 1); }
+                else { STRINGS_COUNT(stats::Engine::StreamRabinKarp, hits, 1); hits.emplace_back(s, (int) m); }
+            }
+        }
+        return hits;
+    }
+    vector<Hit> finish() { hb = 0; pos = 0; return {}; }
+};
+
+// incremental search starts here
+// (a text that keeps changing, e.g. a tailed log or terminal scrollback: the hits of one pattern
+// are kept up to date as the text is edited, without rescanning what did not change)
+
+// owns the text and its hits, sorted by start; append() resumes Knuth-Morris-Pratt from the state
+// left at the end of the text, so a session of appends costs O(total bytes); replace() rescans
+// only the bytes within m-1 of the edit and moves the hits behind it by the change in length;
+// computes in O(k+m) per append of k bytes and O(k+m+h) per edit, h hits behind it; uses
+// O(n+m+h) memory
+class IncrementalSearch {
+private:
+    string pattern;
+    compiled::KnuthMorrisPratt automaton;
+    string text;
+    vector<Hit> found;
+    int j = 0; //length of the pattern prefix matched at the end of the text
+
+    int m() const { return (int) pattern.size(); }
+    // the state left by the last m-1 bytes, which is all the state depends on (no hit fits in them)
+    void resume() {
+        j = 0;
+        for (size_t i = text.size() - min(text.size(), pattern.size() - 1); i < text.size(); ++i) {
+            while (j > 0 && text[i] != pattern[j]) { j = automaton.prefix[j-1]; }
+            if (text[i] == pattern[j]) { ++j; }
+        }
+    }
+public:
+    explicit IncrementalSearch(string_view p, string_view initial = {}) : pattern(p), automaton(pattern) {
+        if (pattern.empty()) { throw invalid_argument("empty pattern"); }
+        append(initial);
+    }
+    string_view view() const { return text; }
+    const vector<Hit>& hits() const { return found; }
+    // the match views this->view() and this->pattern, valid until the next edit
+    Match search() const { return {text, pattern, found}; }
+    void append(string_view bytes) {
+        STRINGS_TIMER(stats::Engine::IncrementalSearch);
+        STRINGS_COUNT(stats::Engine::IncrementalSearch, bytes, bytes.size());
+        STRINGS_COUNT(stats::Engine::IncrementalSearch, comparisons, bytes.size());
+        for (char c : bytes) {
+            while (j > 0 && c != pattern[j]) {
+                STRINGS_COUNT(stats::Engine::IncrementalSearch, failureLinks, 1);
+                STRINGS_COUNT(stats::Engine::IncrementalSearch, comparisons, 1);
+                j = automaton.prefix[j-1];
+            }
+            if (c == pattern[j]) { ++j; }
+            text.push_back(c);
+            if (j == m()) {
+                STRINGS_COUNT(stats::Engine::IncrementalSearch, hits, 1);
+                found.emplace_back((Offset) text.size() - m(), m());
+                j = automaton.prefix[j-1];
+            }
+        }
+    }
+    // text[pos, pos+erased) becomes bytes: the hits overlapping that range (or spanning pos when it
+    // is empty) are dropped, the ones after it move, and only the new starts in
+    // [pos-m+1, pos+bytes.size()) are searched for; the rescan is counted as bytes and hits here, its
+    // comparisons under KnuthMorrisPratt, whose policy does them
+    void replace(size_t pos, size_t erased, string_view bytes) {
+        if (pos > text.size()) { throw out_of_range("IncrementalSearch::replace"); }
+        STRINGS_TIMER(stats::Engine::IncrementalSearch);
+        erased = min(erased, text.size() - pos);
+        Offset lo = (Offset) pos - m() + 1, oldEnd = (Offset) (pos + erased), newEnd = (Offset) (pos + bytes.size());
+        auto first = lower_bound(found.begin(), found.end(), lo, [](const Hit& h, Offset s) { return h.start < s; });
+        auto last = lower_bound(first, found.end(), oldEnd, [](const Hit& h, Offset s) { return h.start < s; });
+        for (auto it = last; it != found.end(); ++it) { it->start += newEnd - oldEnd; }
+        text.replace(pos, erased, bytes);
+        vector<Hit> fresh;
+        size_t from = (size_t) max<Offset>(lo, 0), to = min(text.size(), (size_t) newEnd + pattern.size() - 1);
+        if (from < to && to - from >= pattern.size()) {
+            auto collect = [&](Offset s) {
+                if ((Offset) from + s >= newEnd) { return false; } //a start of the unchanged tail
+                fresh.emplace_back((Offset) from + s, m());
+                return true;
+            };
+            automaton.scan(string_view(text).substr(from, to - from), pattern, collect);
+            STRINGS_COUNT(stats::Engine::IncrementalSearch, bytes, to - from);
+            STRINGS_COUNT(stats::Engine::IncrementalSearch, hits, fresh.size());
+        }
+        first = found.erase(first, last);
+        found.insert(first, fresh.begin(), fresh.end());
+        resume(); //O(m), whether or not the edit reached the last m-1 bytes
+    }
+    void insert(size_t pos, string_view bytes) { replace(pos, 0, bytes); }
+    void erase(size_t pos, size_t count) { replace(pos, count, {}); }
+};
+
+// approximate matchers start here
+// (bit-parallel over one machine word, so the pattern is limited to 64 bytes; both report
+// accuracy = 1 - errors/m, which makes Match's sorted-by-accuracy output meaningful)
+
+// per byte, the set of pattern positions holding it (bit i for pattern[i])
+array<uint64_t, sigma> PositionMasks(string_view pattern) {
+    array<uint64_t, sigma> masks {};
+    for (size_t i = 0; i < pattern.size(); ++i) { masks[(unsigned char) pattern[i]] |= 1ULL << i; }
+    return masks;
+}
+
+// k-mismatch (Hamming) search, Wu-Manber's shift-and with one state word per error count:
+// bit i of r[d] says pattern[0..i] ends here with <= d substitutions;
+// computes in n*(k+1) word operations = O(nk); uses O(sigma+k) memory
+// with top > 0 only the top best windows are kept (sorted), and once that many are held the
+// error budget drops below the worst of them, down to stopping when all of them are exact
+Match KMismatch(string_view base, string_view pattern, int k, bool sorted = false, size_t top = 0) {
     vector<Hit> hits;
-    int n = (int) base.size();
+    Offset n = (Offset) base.size();
     int m = (int) pattern.size();
-    // bad character shift table, preprocessing in O(sigma+m):
-    vector<int> table (sigma, m);
-    for (int i = 0; i < m-1; ++i) { table[pattern[i]] = m-i-1; }
-    //global shift
-    int shift = 0;
-    while (shift < n-m) { //
-        int i = m-1;
-        while (i >= 0 and pattern[i] == base[i+shift]) { --i; }
-        if (i==-1) { hits.emplace_back(shift,m); }
-        char badchar = base[i+shift];
-        shift += (table[badchar]>1) ? table[badchar] : 1;
+    if (m > 64) { throw invalid_argument("approximate patterns are limited to 64 bytes"); }
+    if (m == 0 || n < m) { return {base, pattern, hits, sorted}; }
+    k = max(0, min(k, m));
+    STRINGS_TIMER(stats::Engine::KMismatch);
+    STRINGS_COUNT(stats::Engine::KMismatch, bytes, n);
+    array<uint64_t, sigma> masks = PositionMasks(pattern);
+    uint64_t high = 1ULL << (m-1);
+    vector<uint64_t> r (k+1, 0);
+    TopHits best(top);
+    for (Offset j = 0; j < n; ++j) {
+        if (top > 0 && best.full()) { //only strictly fewer errors than the k-th best can get in
+            k = min(k, (int) lround((1.0f - best.worst().accuracy) * (float) m) - 1);
+            if (k < 0) { break; }
+        }
+        uint64_t mask = masks[(unsigned char) base[j]];
+        uint64_t prev = r[0]; //r[d-1] before this byte
+        r[0] = ((r[0] << 1) | 1) & mask;
+        for (int d = 1; d <= k; ++d) {
+            uint64_t old = r[d];
+            r[d] = (((r[d] << 1) | 1) & mask) | ((prev << 1) | 1); //match, or substitute
+            prev = old;
+        }
+        if (j < m-1) { continue; } //no full window yet
+        for (int d = 0; d <= k; ++d) {
+            if (!(r[d] & high)) { continue; }
+            Hit h(j-m+1, m, 1.0f - (float) d / (float) m);
+            STRINGS_COUNT(stats::Engine::KMismatch, hits, 1);
+            if (top > 0) { best.push(h); } else { hits.push_back(h); }
+            break;
+        }
     }
-    return {base, pattern, hits};
+    if (top > 0) { return {base, pattern, best.take(), true}; }
+    return {base, pattern, hits, sorted};
 }
 
-int main() {
-    string x = "queLorem ipsum dolor sit amet, consectetur adipiscing elit. Morbi pellentesque rutrum mauris a pretium. Duis sodales vitae lorem id vulputate. Nullam vitae dui interdum, sollicitudin urna quis, mollis ligula. Vestibulum ante ipsum primis in faucibus orci luctus et ultrices posuere cubilia curae; Vestibulum turpis augue, cursus vel mi non, dictum convallis metus. Nunc et leo efficitur, auctor est in, porttitor libero. Ut vulputate cursus condimentum.\n"
-               "Vestibulum sit amet fermentum lorem, at dictum nunc. Aliquam scelerisque condimentum massa a blandit. Vestibulum eu velit sagittis, tincidunt dolor ac, iaculis lacus. Integer quis varius ligula. Lorem ipsum dolor sit amet, consectetur adipiscing elit. Suspendisse ut fermentum libero, at pretium nisl. Pellentesque consectetur mi tortor, id elementum felis eleifend eu. Duis vehicula eget sapien eget ultrices. Ut sem lectus, pulvinar ac est sed, rutrum mattis purus. Duis ultricies enim accumsan ante finibus suscipit. Ut consectetur velit a eros commodo, sed iaculis neque vulputate. Nulla venenatis rhoncus porttitor. Pellentesque blandit venenatis felis, eleifend consequat mauris consectetur a. Praesent eget vulputate sapien. Sed rutrum cursus lectus id consequat.\n"
-               "In ac tortor at odio ornare posuere. Mauris gravida neque a diam sodales tempor. Quisque pellentesque lacus nisi, ac fermentum lacus rhoncus vel. Sed ac viverra orci. Lorem ipsum dolor sit amet, consectetur adipiscing elit. Vivamus in convallis nulla. Nam faucibus nisi nec posuere pulvinar. Maecenas fringilla quam in ultricies scelerisque. Proin ac mi et ex malesuada dictum. Nullam tincidunt leo lacus, et porta sapien cursus porta. Orci varius natoque penatibus et magnis dis parturient montes, nascetur ridiculus mus.\n"
-               "Mauris ultrices vel sem vel laoreet. Phasellus lacus nisl, tincidunt vel libero et, semper pharetra libero. Fusce augue diam, tristique ac blandit quis, finibus vel mi. Curabitur at dolor pretium ex ornare posuere. Mauris egestas eros neque, sit amet tempor sem ornare sed. Pellentesque turpis mi, tincidunt ut efficitur sed, feugiat sit amet magna. Maecenas quam lectus, iaculis nec elit non, vehicula convallis tortor. Aliquam viverra efficitur molestie. Fusce pulvinar ac odio sit amet dignissim. In vitae risus feugiat, convallis turpis a, ullamcorper leo. Donec ornare leo justo, ut interdum neque sodales sed. Donec elit nisi, congue eu metus quis, condimentum egestas orci. Nam eget sem nibh.\n"
-               "Nullam vitae enim ut odio ornare maximus. Aliquam malesuada felis ex, sed tristique diam egestas vel. Ut ac egestas elit, sed condimentum est. Suspendisse potenti. Fusce feugiat dictum lacus at lobortis. Sed consectetur nunc id pretium vestibulum. Morbi viverra mauris et dapibus mattis. Donec ultricies augue tincidunt mauris dignissim, ac commodo mauris suscipitque.";
-    string y = "que";
-//    string x = "Sampletextsamplestringsample.";
-//    string y = "ampl";
-    Match naive = Naive(x, y);
-    Match rk = RabinKarp(x, y);
-    Match kmp = KnuthMorrisPratt(x, y);
-    Match bm = BoyerMoore(x, y);
-    cout << "Naive:\n" << naive << "\n";
-    cout << "Rabin-Karp:\n" << rk << "\n";
-    cout << "Knuth-Morris-Pratt:\n" << kmp << "\n";
-    cout << "Boyer-Moore:\n" << bm << "\n";
+// k-edit (Levenshtein) search, Myers' bit-vector algorithm: the last DP column is kept as
+// vertical +1/-1 deltas (pv/mv) and advanced by one text byte in O(1) word operations;
+// an end within k edits yields a hit where the score has a local minimum: below the score of the
+// end before it (or exact, as adjacent exact ends are distinct matches) and no worse than the one
+// after it; a plateau of equal scores yields its first end and then one every m ends; the start
+// comes from an anchored Myers pass of the reversed pattern run backwards from that end;
+// computes in n word steps + O(m+k) per hit = O(n + h(m+k)); uses O(sigma) memory
+// with top > 0 only the top best hits are kept (sorted): a hit that cannot beat the k-th best
+// skips its start recovery, and the scan stops once top exact hits are held
+Match KEdit(string_view base, string_view pattern, int k, bool sorted = false, size_t top = 0) {
+    vector<Hit> hits;
+    Offset n = (Offset) base.size();
+    int m = (int) pattern.size();
+    if (m > 64) { throw invalid_argument("approximate patterns are limited to 64 bytes"); }
+    if (m == 0 || n == 0) { return {base, pattern, hits, sorted}; }
+    k = max(0, min(k, m-1)); //m edits match anything, even the empty string
+    STRINGS_TIMER(stats::Engine::KEdit);
+    STRINGS_COUNT(stats::Engine::KEdit, bytes, n);
+    array<uint64_t, sigma> forward = PositionMasks(pattern);
+    string reversed(pattern.rbegin(), pattern.rend());
+    array<uint64_t, sigma> backward = PositionMasks(reversed);
+    uint64_t high = 1ULL << (m-1);
+    // one column step; anchored adds the +1 of the DP's first row (text start not free)
+    auto step = [high](const array<uint64_t, sigma>& masks, unsigned char c, uint64_t& pv, uint64_t& mv, int& score, bool anchored) {
+        uint64_t eq = masks[c];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        if (ph & high) { ++score; } else if (mh & high) { --score; }
+        ph = (ph << 1) | (anchored ? 1 : 0);
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    };
+    // shortest text ending at end that reaches the best score, i.e. the hit's start
+    auto start = [&](Offset end, int best) {
+        uint64_t pv = ~0ULL, mv = 0;
+        int score = m;
+        for (Offset t = end; t >= 0 && t >= end-m-k; --t) {
+            step(backward, (unsigned char) base[t], pv, mv, score, true);
+            if (score <= best) { return t; }
+        }
+        return max<Offset>(0, end-m+1);
+    };
+    uint64_t pv = ~0ULL, mv = 0;
+    int score = m, previous = m; //the score of the end before, m before the text
+    int best = -1; //the score of the end waiting for the next one to confirm it, < 0 if none
+    Offset bestEnd = -1, last = -m; //the last end reported
+    TopHits kept(top);
+    auto emit = [&] {
+        float accuracy = 1.0f - (float) best / (float) m;
+        if (top == 0 || kept.admits(accuracy)) {
+            STRINGS_COUNT(stats::Engine::KEdit, verifications, 1);
+            STRINGS_COUNT(stats::Engine::KEdit, hits, 1);
+            Offset s = start(bestEnd, best);
+            Hit h(s, (int) (bestEnd-s+1), accuracy);
+            if (top > 0) { kept.push(h); } else { hits.push_back(h); }
+        }
+        last = bestEnd;
+        best = -1;
+    };
+    for (Offset j = 0; j < n; ++j) {
+        if (top > 0 && best < 0 && kept.full() && kept.worst().accuracy >= 1.0f) { break; } //nothing beats top exact hits
+        step(forward, (unsigned char) base[j], pv, mv, score, false);
+        if (best >= 0) {
+            if (score >= best) { emit(); } else { best = -1; } //still falling: not a minimum
+        }
+        if (score <= k && (score < previous || score == 0 || j >= last + m)) { best = score; bestEnd = j; }
+        previous = score;
+    }
+    if (best >= 0) { emit(); }
+    if (top > 0) { return {base, pattern, kept.take(), true}; }
+    return {base, pattern, hits, sorted};
+}
+
+// multi-pattern matchers start here
+
+// Aho-Corasick:
+// builds in O(total pattern length * sigma) for the dense part, then searches every pattern at once
+// in n transitions + one step per hit = O(n+h); uses O(nodes*sigma) near the root, O(nodes) below it
+// layout: nodes are numbered in BFS order, so the shallow, hot part of the automaton is contiguous;
+// nodes up to denseDepth own a full sigma-wide row of precomputed transitions (the root always does),
+// deeper ones keep their byte-sorted trie edges (CSR) and fall back along failure links when missing
+class AhoCorasick {
+private:
+    vector<int> length; //per pattern id
+    vector<int> fail; //per node: longest proper suffix that is also a trie node
+    vector<int> dict; //per node: nearest node on the failure chain that ends a pattern, -1 for none
+    vector<int> row; //per node: its row in dense, -1 for sparse nodes
+    vector<int> dense; //row*sigma+c -> next node
+    vector<int> edgeStart; //node -> [edgeStart[node], edgeStart[node+1]) in edgeByte/edgeTo
+    vector<unsigned char> edgeByte;
+    vector<int> edgeTo;
+    vector<int> outStart; //node -> [outStart[node], outStart[node+1]) in outIds
+    vector<int> outIds;
+
+    int child(int s, unsigned char c) const { //trie edge or -1
+        auto b = edgeByte.begin() + edgeStart[s], e = edgeByte.begin() + edgeStart[s+1];
+        auto it = lower_bound(b, e, c);
+        return (it != e && *it == c) ? edgeTo[it - edgeByte.begin()] : -1;
+    }
+    int next(int s, unsigned char c) const { //goto function, terminates at the latest on the (dense) root
+        while (row[s] < 0) {
+            int t = child(s, c);
+            if (t >= 0) { return t; }
+            s = fail[s];
+        }
+        return dense[row[s]*sigma + c];
+    }
+public:
+    explicit AhoCorasick(const vector<string>& patterns, int denseDepth = 1) {
+        //plain trie first, numbered in insertion order
+        vector<vector<pair<unsigned char, int>>> kids(1);
+        vector<vector<int>> ends(1);
+        for (int id = 0; id < (int) patterns.size(); ++id) {
+            if (patterns[id].empty()) { throw invalid_argument("empty pattern"); }
+            int s = 0;
+            for (char ch : patterns[id]) {
+                auto c = (unsigned char) ch;
+                auto it = find_if(kids[s].begin(), kids[s].end(), [c](const pair<unsigned char, int>& k){ return k.first == c; });
+                if (it != kids[s].end()) { s = it->second; continue; }
+                kids[s].emplace_back(c, (int) kids.size());
+                s = (int) kids.size();
+                kids.emplace_back();
+                ends.emplace_back();
+            }
+            ends[s].push_back(id);
+            length.push_back((int) patterns[id].size());
+        }
+        //renumber in BFS order and flatten edges and outputs into CSR arrays
+        int nodes = (int) kids.size();
+        vector<int> order {0}, rank(nodes);
+        for (int k = 0; k < (int) order.size(); ++k) {
+            sort(kids[order[k]].begin(), kids[order[k]].end());
+            for (auto& e : kids[order[k]]) { order.push_back(e.second); }
+        }
+        for (int k = 0; k < nodes; ++k) { rank[order[k]] = k; }
+        edgeStart.assign(nodes + 1, 0);
+        outStart.assign(nodes + 1, 0);
+        vector<int> level(nodes, 0);
+        for (int k = 0; k < nodes; ++k) {
+            for (auto& e : kids[order[k]]) {
+                edgeByte.push_back(e.first);
+                edgeTo.push_back(rank[e.second]);
+                level[rank[e.second]] = level[k] + 1;
+            }
+            for (int id : ends[order[k]]) { outIds.push_back(id); }
+            edgeStart[k+1] = (int) edgeTo.size();
+            outStart[k+1] = (int) outIds.size();
+        }
+        //failure links, dictionary links and dense rows, parents strictly before children
+        fail.assign(nodes, 0);
+        dict.assign(nodes, -1);
+        row.assign(nodes, -1);
+        for (int u = 0; u < nodes; ++u) {
+            if (u > 0) {
+                int f = fail[u];
+                dict[u] = (outStart[f+1] > outStart[f]) ? f : dict[f];
+            }
+            if (level[u] <= denseDepth) {
+                row[u] = (int) (dense.size() / sigma);
+                dense.resize(dense.size() + sigma);
+                for (int c = 0; c < sigma; ++c) {
+                    int t = child(u, (unsigned char) c);
+                    dense[row[u]*sigma + c] = (t >= 0) ? t : (u == 0) ? 0 : next(fail[u], (unsigned char) c);
+                }
+            }
+            for (int k = edgeStart[u]; k < edgeStart[u+1]; ++k) {
+                fail[edgeTo[k]] = (u == 0) ? 0 : next(fail[u], edgeByte[k]);
+            }
+        }
+    }
+    int patterns() const { return (int) length.size(); }
+    // visit(const Hit&) per hit in order of their end position, tagged with the pattern id;
+    // the visitor may return bool, false stops the scan
+    template <typename Visitor>
+    void scan(string_view base, Visitor&& visit) const {
+        STRINGS_TIMER(stats::Engine::AhoCorasick);
+        STRINGS_COUNT(stats::Engine::AhoCorasick, bytes, base.size());
+        Offset n = (Offset) base.size();
+        int s = 0;
+        for (Offset i = 0; i < n; ++i) {
+            s = next(s, (unsigned char) base[i]);
+            for (int o = (outStart[s+1] > outStart[s]) ? s : dict[s]; o >= 0; o = dict[o]) {
+                for (int k = outStart[o]; k < outStart[o+1]; ++k) {
+                    int id = outIds[k];
+                    STRINGS_COUNT(stats::Engine::AhoCorasick, hits, 1);
+                    if (!Visit(visit, Hit(i - length[id] + 1, length[id], 1.0f, id))) { return; }
+                }
+            }
+        }
+    }
+    vector<Hit> search(string_view base) const {
+        vector<Hit> hits;
+        scan(base, [&](const Hit& h) { hits.push_back(h); });
+        return hits;
+    }
+};
+
+// Rabin-Karp over a set of same-length patterns:
+// one rolling hash per position is looked up in a flat open-addressing table (linear probing,
+// load <= 1/2), and only equal hashes are compared; computes in O(n + k*m) expected + O(m) per
+// candidate; uses O(k*m) memory for k patterns
+class RabinKarpSet {
+private:
+    struct Slot {
+        uint64_t hash;
+        int id; //-1 for an empty slot
+    };
+    int m = 0;
+    string flat; //pattern id lives at flat[id*m .. id*m+m)
+    vector<Slot> table;
+    uint64_t lead = 1;
+    int bits = 1;
+
+    size_t home(uint64_t h) const { return (size_t) ((h * 0x9E3779B97F4A7C15ULL) >> (64 - bits)); } //Fibonacci hashing
+public:
+    explicit RabinKarpSet(const vector<string>& patterns) {
+        if (patterns.empty()) { return; }
+        m = (int) patterns[0].size();
+        if (m == 0) { throw invalid_argument("empty pattern"); }
+        while ((1ULL << bits) < 2 * patterns.size()) { ++bits; }
+        table.assign((size_t) 1 << bits, Slot {0, -1});
+        for (int id = 0; id < (int) patterns.size(); ++id) {
+            if ((int) patterns[id].size() != m) { throw invalid_argument("patterns differ in length"); }
+            flat += patterns[id];
+            uint64_t h = mersenne::hash(patterns[id]);
+            size_t k = home(h);
+            while (table[k].id >= 0) { k = (k + 1) & (table.size() - 1); }
+            table[k] = {h, id};
+        }
+        lead = mersenne::lead(m);
+    }
+    int patterns() const { return m == 0 ? 0 : (int) flat.size() / m; }
+    // visit(const Hit&) per hit ordered by start, then by pattern id for duplicates (equal hashes
+    // share a home slot, so linear probing keeps them in insertion order); false from visit stops
+    template <typename Visitor>
+    void scan(string_view base, Visitor&& visit) const {
+        STRINGS_TIMER(stats::Engine::RabinKarpSet);
+        STRINGS_COUNT(stats::Engine::RabinKarpSet, bytes, base.size());
+        Offset n = (Offset) base.size();
+        if (m == 0 || n < m) { return; }
+        uint64_t hb = mersenne::hash(base.substr(0, m));
+        for (Offset i = 0; i <= n - m; ++i) {
+            for (size_t k = home(hb); table[k].id >= 0; k = (k + 1) & (table.size() - 1)) {
+                const Slot& slot = table[k];
+                if (slot.hash != hb) { continue; }
+                STRINGS_COUNT(stats::Engine::RabinKarpSet, verifications, 1);
+                if (base.compare(i, m, flat, (size_t) slot.id * m, m) != 0) { //fp check
+                    STRINGS_COUNT(stats::Engine::RabinKarpSet, collisions, 1);
+                    continue;
+                }
+                STRINGS_COUNT(stats::Engine::RabinKarpSet, hits, 1);
+                if (!Visit(visit, Hit(i, m, 1.0f, slot.id))) { return; }
+            }
+            if (i == n - m) { break; }
+            hb = mersenne::roll(hb, base[i], base[i + m], lead);
+        }
+    }
+    vector<Hit> search(string_view base) const {
+        vector<Hit> hits;
+        scan(base, [&](const Hit& h) { hits.push_back(h); });
+        return hits;
+    }
+};
+
+// wildcard patterns start here
+// (syntax: ? any byte, * any run of bytes, both stopping at '\n'; [abc] [a-z] [^...] byte classes;
+// (a|b) groups and top-level a|b alternation; \ takes the next byte literally, everything else is
+// itself; matches are reported leftmost-longest and non-overlapping, empty matches never)
+
+// back end: a Thompson NFA over byte classes, turned into a DFA lazily, one state per set of NFA
+// states actually reached, with its 256 transitions filled in on first use and kept for later
+// searches (flushed when it grows past maxStates); front end: the longest literal factor every
+// match must contain (or a group of literal alternatives) is looked for with the exact matchers,
+// and only starts a bounded distance before each occurrence (back to the line start after a *)
+// are tried by the DFA; computes in
+// ~O(n/W) + O(L) per candidate start on selective literals, O(nL) worst case for L the longest
+// attempt; uses O(maxStates*sigma) memory; search() mutates the cache, so keep one per thread
+class Wildcard {
+private:
+    static constexpr int unbounded = numeric_limits<int>::max();
+    static constexpr int maxStates = 1024;
+    using Bytes = bitset<sigma>;
+
+    struct Node {
+        enum Kind { Set, Any, Concat, Alt } kind;
+        Bytes bytes; //Set, and Any that stops at '\n'
+        vector<Node> kids;
+        int shortest() const {
+            if (kind == Set) { return 1; }
+            if (kind == Any) { return 0; }
+            int l = (kind == Concat) ? 0 : unbounded;
+            for (const Node& k : kids) { l = (kind == Concat) ? l + k.shortest() : min(l, k.shortest()); }
+            return l;
+        }
+        int longest() const {
+            if (kind == Set) { return 1; }
+            if (kind == Any) { return unbounded; }
+            int l = 0;
+            for (const Node& k : kids) {
+                int kl = k.longest();
+                if (kl == unbounded) { return unbounded; }
+                l = (kind == Concat) ? l + kl : max(l, kl);
+            }
+            return l;
+        }
+        bool newline() const { //can it match a '\n'
+            if (kind == Set) { return bytes['\n']; }
+            return any_of(kids.begin(), kids.end(), [](const Node& k) { return k.newline(); });
+        }
+        bool literal(string* out) const { //a fixed string (one byte per kid of a Concat)
+            if (kind == Set && bytes.count() == 1) {
+                for (int c = 0; c < sigma; ++c) { if (bytes[c]) { *out += (char) c; } }
+                return true;
+            }
+            if (kind != Concat) { return false; }
+            for (const Node& k : kids) { if (k.kind != Set || !k.literal(out)) { return false; } }
+            return true;
+        }
+    };
+
+    // recursive descent: alt := concat ('|' concat)*, concat := item*, item := ( alt ) | [class] | ? | * | \x | x
+    struct Parser {
+        string_view p;
+        size_t at = 0;
+        [[noreturn]] void fail(const char* what) const { throw invalid_argument(string(what) + " at offset " + to_string(at) + " of wildcard pattern"); }
+        Node alt() {
+            Node n {Node::Alt, {}, {concat()}};
+            while (at < p.size() && p[at] == '|') { ++at; n.kids.push_back(concat()); }
+            return (n.kids.size() == 1) ? std::move(n.kids[0]) : n;
+        }
+        Node concat() {
+            Node n {Node::Concat, {}, {}};
+            while (at < p.size() && p[at] != '|' && p[at] != ')') { n.kids.push_back(item()); }
+            return n;
+        }
+        Node item() {
+            char c = p[at++];
+            if (c == '(') {
+                Node n = alt();
+                if (at >= p.size() || p[at] != ')') { fail("missing )"); }
+                ++at;
+                return n;
+            }
+            Node n {Node::Set, {}, {}};
+            if (c == '?' || c == '*') {
+                n.bytes.set().reset('\n');
+                if (c == '*') { n.kind = Node::Any; }
+                return n;
+            }
+            if (c == '[') { return range(); }
+            if (c == '\\') {
+                if (at >= p.size()) { fail("trailing \\"); }
+                c = p[at++];
+            }
+            n.bytes.set((unsigned char) c);
+            return n;
+        }
+        Node range() {
+            Node n {Node::Set, {}, {}};
+            bool negate = at < p.size() && p[at] == '^';
+            if (negate) { ++at; }
+            for (bool first = true; ; first = false) {
+                if (at >= p.size()) { fail("missing ]"); }
+                if (p[at] == ']' && !first) { ++at; break; } //a leading ] is a member
+                if (p[at] == '\\' && at + 1 < p.size()) { ++at; }
+                auto lo = (unsigned char) p[at++], hi = lo;
+                if (at + 1 < p.size() && p[at] == '-' && p[at+1] != ']') {
+                    hi = (unsigned char) p[at+1];
+                    at += 2;
+                    if (hi < lo) { fail("reversed range"); }
+                }
+                for (int b = lo; b <= hi; ++b) { n.bytes.set(b); }
+            }
+            if (negate) { n.bytes.flip(); }
+            return n;
+        }
+    };
+
+    // NFA: kind Set consumes a byte of sets[set] and goes to out; Split goes to out and out1 for free
+    struct State {
+        enum Kind { Set, Split, Accept } kind;
+        int set = -1, out = -1, out1 = -1;
+    };
+    string text; //the pattern as written
+    vector<State> nfa;
+    vector<Bytes> sets;
+    int nfaStart = 0;
+    // lazy DFA; transitions are -2 until computed, -1 is the dead state
+    mutable map<vector<int>, int> interned;
+    mutable vector<vector<int>> members; //DFA state -> its NFA states (Set and Accept only)
+    mutable vector<int> next;
+    mutable vector<bool> accepting;
+    mutable Bytes firsts; //bytes a match can start with
+    // prefilter
+    int minPrefix = 0, maxPrefix = 0; //distance from a match start to the factor
+    static constexpr size_t fewFactors = 8; //up to this many alternatives one SIMD pass each beats Aho-Corasick
+    vector<CompiledPattern<compiled::SimdFilter>> factor;
+    unique_ptr<AhoCorasick> factors;
+
+    int compile(const Node& n, int out) { //continuation style: returns the entry of n followed by out
+        auto add = [&](State s) { nfa.push_back(s); return (int) nfa.size() - 1; };
+        switch (n.kind) {
+            case Node::Set:
+                sets.push_back(n.bytes);
+                return add({State::Set, (int) sets.size() - 1, out});
+            case Node::Any: {
+                int loop = add({State::Split, -1, -1, out});
+                sets.push_back(n.bytes);
+                nfa[loop].out = add({State::Set, (int) sets.size() - 1, loop});
+                return loop;
+            }
+            case Node::Concat:
+                for (auto k = n.kids.rbegin(); k != n.kids.rend(); ++k) { out = compile(*k, out); }
+                return out;
+            case Node::Alt: {
+                int entry = compile(n.kids.back(), out);
+                for (int k = (int) n.kids.size() - 2; k >= 0; --k) { entry = add({State::Split, -1, compile(n.kids[k], out), entry}); }
+                return entry;
+            }
+        }
+        return out;
+    }
+    void closure(int s, vector<int>& into, vector<bool>& seen) const {
+        if (s < 0 || seen[s]) { return; }
+        seen[s] = true;
+        if (nfa[s].kind == State::Split) { closure(nfa[s].out, into, seen); closure(nfa[s].out1, into, seen); }
+        else { into.push_back(s); }
+    }
+    int intern(vector<int> set) const {
+        if (set.empty()) { return -1; }
+        sort(set.begin(), set.end());
+        auto it = interned.find(set);
+        if (it != interned.end()) { return it->second; }
+        int id = (int) members.size();
+        accepting.push_back(any_of(set.begin(), set.end(), [&](int s) { return nfa[s].kind == State::Accept; }));
+        interned.emplace(set, id);
+        members.push_back(std::move(set));
+        next.resize(members.size() * sigma, -2);
+        return id;
+    }
+    int start() const {
+        if (members.empty()) {
+            vector<int> set;
+            vector<bool> seen(nfa.size(), false);
+            closure(nfaStart, set, seen);
+            intern(set);
+        }
+        return 0;
+    }
+    int step(int d, unsigned char c) const {
+        int& t = next[(size_t) d * sigma + c];
+        if (t != -2) { return t; }
+        vector<int> set;
+        vector<bool> seen(nfa.size(), false);
+        for (int s : members[d]) { if (nfa[s].kind == State::Set && sets[nfa[s].set][c]) { closure(nfa[s].out, set, seen); } }
+        if ((int) members.size() >= maxStates) { //flush, keeping only what the caller still holds
+            vector<int> keep = members[d];
+            interned.clear(); members.clear(); next.clear(); accepting.clear();
+            start();
+            d = intern(keep);
+        }
+        int to = intern(set);
+        next[(size_t) d * sigma + c] = to;
+        return to;
+    }
+    // length of the longest match starting at base[from], 0 if there is none
+    int longestAt(string_view base, Offset from) const {
+        Offset n = (Offset) base.size();
+        int best = 0, d = start();
+        for (Offset i = from; i < n; ++i) {
+            d = step(d, (unsigned char) base[i]);
+            if (d < 0) { break; }
+            if (accepting[d]) { best = HitLength(from, i + 1); }
+        }
+        return best;
+    }
+public:
+    explicit Wildcard(string_view pattern) : text(pattern) {
+        Parser parser {text};
+        Node root = parser.alt();
+        if (parser.at != text.size()) { parser.fail("unbalanced )"); }
+        nfa.push_back({State::Accept});
+        nfaStart = compile(root, 0);
+        for (int c = 0, d = start(); c < sigma; ++c) { firsts[c] = step(d, (unsigned char) c) >= 0; }
+        //the best factor among the top-level items: a literal run, or a group of literal alternatives
+        vector<const Node*> items;
+        if (root.kind == Node::Concat) { for (const Node& k : root.kids) { items.push_back(&k); } }
+        else { items.push_back(&root); }
+        pair<bool, int> best {false, 0}; //bounded window first, then the shortest literal's length
+        string run;
+        int runStart = 0;
+        auto consider = [&](vector<string> literals, int first) {
+            if (literals.empty()) { return; }
+            int score = (int) min_element(literals.begin(), literals.end(), [](const string& a, const string& b) { return a.size() < b.size(); })->size();
+            int lo = 0, hi = 0;
+            bool newline = false;
+            for (int k = 0; k < first; ++k) {
+                lo += items[k]->shortest();
+                int l = items[k]->longest();
+                hi = (hi == unbounded || l == unbounded) ? unbounded : hi + l;
+                newline = newline || items[k]->newline();
+            }
+            if (hi == unbounded && newline) { return; } //an unbounded window has to stop at a line break
+            pair<bool, int> rank {hi != unbounded, score};
+            if (rank <= best) { return; }
+            best = rank;
+            minPrefix = lo;
+            maxPrefix = hi;
+            factor.clear();
+            factors.reset();
+            if (literals.size() <= fewFactors) { for (const string& l : literals) { factor.emplace_back(l); } }
+            else { factors = make_unique<AhoCorasick>(literals); }
+        };
+        for (int k = 0; k <= (int) items.size(); ++k) {
+            string c;
+            if (k < (int) items.size() && items[k]->kind != Node::Alt && items[k]->literal(&c)) {
+                if (run.empty()) { runStart = k; }
+                run += c;
+                continue;
+            }
+            if (!run.empty()) { consider({run}, runStart); run.clear(); }
+            if (k < (int) items.size() && items[k]->kind == Node::Alt) {
+                vector<string> literals;
+                for (const Node& a : items[k]->kids) {
+                    string s;
+                    if (!a.literal(&s) || s.empty()) { literals.clear(); break; }
+                    literals.push_back(s);
+                }
+                consider(literals, k);
+            }
+        }
+    }
+    string_view pattern() const { return text; }
+    // visit(const Hit&) per match in order; may return bool, false stops
+    template <typename Visitor>
+    void scan(string_view base, Visitor&& visit) const {
+        STRINGS_TIMER(stats::Engine::Wildcard);
+        STRINGS_COUNT(stats::Engine::Wildcard, bytes, base.size());
+        Offset n = (Offset) base.size(), from = 0; //no match may start before from
+        Offset tried = 0; //every start before this one was tried already
+        bool stopped = false;
+        auto attempt = [&](Offset lo, Offset hi) { //tries the starts in [lo, hi]
+            for (Offset s = max({lo, from, tried}); s <= hi && s < n && !stopped; ++s) {
+                if (!firsts[(unsigned char) base[s]]) { continue; }
+                STRINGS_COUNT(stats::Engine::Wildcard, verifications, 1);
+                int l = longestAt(base, s);
+                if (l == 0) { continue; }
+                STRINGS_COUNT(stats::Engine::Wildcard, hits, 1);
+                stopped = !Visit(visit, Hit(s, l));
+                from = s + l;
+                s = from - 1;
+            }
+            tried = max(tried, hi + 1);
+        };
+        auto window = [&](Offset q) { //q: an occurrence of the factor
+            Offset hi = q - minPrefix;
+            if (hi < from) { return !stopped; }
+            Offset lo = 0;
+            if (maxPrefix != unbounded) { lo = q - maxPrefix; }
+            else if (q > from) { //a match cannot reach back across a line break
+                auto nl = (const char*) memrchr(base.data() + from, '\n', (size_t) (q - from));
+                lo = (nl == nullptr) ? from : (Offset) (nl - base.data()) + 1;
+            }
+            attempt(lo, hi);
+            return !stopped;
+        };
+        if (factor.size() == 1) { factor[0].scan(base, window); }
+        else if (!factor.empty() || factors) {
+            vector<Offset> starts; //the windows are worked off by start
+            for (const auto& f : factor) { f.scan(base, [&](Offset q) { starts.push_back(q); return true; }); }
+            if (factors) { factors->scan(base, [&](const Hit& h) { starts.push_back(h.start); }); }
+            sort(starts.begin(), starts.end());
+            for (Offset q : starts) { if (!window(q)) { break; } }
+        }
+        else { attempt(0, n-1); }
+    }
+    // the match views this->pattern(), so it must not outlive the wildcard
+    Match search(string_view base) const {
+        vector<Hit> hits;
+        scan(base, [&](const Hit& h) { hits.push_back(h); });
+        return {base, text, hits};
+    }
+};
+
+// file input starts here
+
+// any of the matchers above, e.g. SearchFile(path, y, BoyerMoore)
+using Matcher = Match (*)(string_view, string_view);
+
+// transparent huge page size on x86-64 and the usual arm64 kernels
+constexpr size_t hugePage = 2 << 20;
+
+// asks for transparent huge pages on a region of at least one huge page, so long scans take a TLB
+// miss per 2 MiB instead of per 4 KiB; best effort: a kernel without THP (or without THP for
+// the page cache, for file mappings) keeps base pages
+void HugePages(void* addr, size_t length) {
+#ifdef MADV_HUGEPAGE
+    if (length >= hugePage) { madvise(addr, length, MADV_HUGEPAGE); }
+#else
+    (void) addr; (void) length;
+#endif
+}
+
+// read-only mapping of a whole file, advised for one sequential pass by default (MADV_RANDOM for
+// indexes that are probed rather than scanned); mapped() is false for pipes, sockets, empty and
+// other non-mappable files (fd stays open)
+class MappedFile {
+private:
+    int fd = -1;
+    void* addr = MAP_FAILED;
+    size_t length = 0;
+public:
+    explicit MappedFile(const char* path, int advice = MADV_SEQUENTIAL) {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { throw system_error(errno, generic_category(), path); }
+        struct stat st {};
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+            length = (size_t) st.st_size;
+            addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED) {
+                madvise(addr, length, advice); //sequential: aggressive readahead, drop pages behind us
+                HugePages(addr, length);
+                if (advice == MADV_SEQUENTIAL) { madvise(addr, length, MADV_WILLNEED); } //start paging in right away
+            }
+        }
+    }
+    ~MappedFile() {
+        if (addr != MAP_FAILED) { munmap(addr, length); }
+        if (fd >= 0) { close(fd); }
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    bool mapped() const { return addr != MAP_FAILED; }
+    string_view text() const { return mapped() ? string_view((const char*) addr, length) : string_view(); }
+    int descriptor() const { return fd; }
+};
+
+// zeroed anonymous memory of at least `bytes` bytes, rounded up to whole huge pages and advised
+// for them (see HugePages); throws bad_alloc when the mapping fails
+class HugeBuffer {
+private:
+    void* addr = MAP_FAILED;
+    size_t length = 0;
+public:
+    explicit HugeBuffer(size_t bytes) : length((max<size_t>(bytes, 1) + hugePage - 1) / hugePage * hugePage) {
+        addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) { throw bad_alloc(); }
+        HugePages(addr, length);
+    }
+    ~HugeBuffer() { munmap(addr, length); }
+    HugeBuffer(const HugeBuffer&) = delete;
+    HugeBuffer& operator=(const HugeBuffer&) = delete;
+    char* data() const { return (char*) addr; }
+    size_t size() const { return length; }
+};
+
+// searches a file without copying it into a std::string:
+// regular files are scanned straight over the mapped pages, everything else is read in chunks
+// (pread while seekable, read for pipes) and each chunk is searched together with the m-1 bytes
+// carried from the previous one, so no match is lost or reported twice; uses O(chunk+m) memory
+vector<Hit> SearchFile(const char* path, string_view pattern, Matcher algo = KnuthMorrisPratt, size_t chunk = 1 << 20) {
+    MappedFile file(path);
+    if (file.mapped()) { return algo(file.text(), pattern).getHits(); }
+
+    vector<Hit> hits;
+    size_t carry = pattern.empty() ? 0 : pattern.size() - 1;
+    string buffer(carry + chunk, '\0');
+    size_t kept = 0; //bytes carried over at the front of buffer
+    Offset offset = 0; //absolute offset of buffer[0]
+    bool seekable = lseek(file.descriptor(), 0, SEEK_CUR) >= 0;
+    while (true) {
+        ssize_t got = seekable ?
+                      pread(file.descriptor(), &buffer[kept], chunk, offset + (Offset) kept) :
+                      read(file.descriptor(), &buffer[kept], chunk);
+        if (got < 0 && errno == EINTR) { continue; }
+        if (got < 0) { throw system_error(errno, generic_category(), path); }
+        if (got == 0) { break; }
+        size_t filled = kept + (size_t) got;
+        Match part = algo(string_view(buffer.data(), filled), pattern);
+        for (const Hit& h : part.getHits()) {
+            hits.emplace_back(offset + h.start, h.length, h.accuracy);
+        }
+        kept = min(carry, filled);
+        copy(buffer.begin() + (long) (filled - kept), buffer.begin() + (long) filled, buffer.begin());
+        offset += (Offset) (filled - kept);
+    }
+    return hits;
+}
+
+// indexes start here
+// (ranks and suffix positions are 32-bit ints, half the memory of Offset per text byte; a corpus
+// of 2 GiB or more is rejected with invalid_argument rather than silently truncated)
+
+// SA-IS (Nong, Zhang, Chan): suffix sorting by induced sorting of the LMS substrings, recursing on
+// their names only when two of them are equal; computes in O(n); uses O(n) memory on top of sa
+namespace sais {
+
+// s[0..n) over [0, k), s[n-1] == 0 the unique smallest symbol (sentinel)
+void build(const int* s, int* sa, int n, int k) {
+    vector<unsigned char> stype(n, 0); //S-type: suffix smaller than the next one (bytes, not bits: hot)
+    stype[n-1] = 1;
+    for (int i = n-2; i >= 0; --i) { stype[i] = s[i] < s[i+1] || (s[i] == s[i+1] && stype[i+1]); }
+    auto lms = [&](int i) { return i > 0 && stype[i] && !stype[i-1]; };
+    vector<int> bucket(k);
+    auto buckets = [&](bool end) { //bucket[c]: first (or one past the last) slot of symbol c
+        fill(bucket.begin(), bucket.end(), 0);
+        for (int i = 0; i < n; ++i) { ++bucket[s[i]]; }
+        for (int c = 0, sum = 0; c < k; ++c) {
+            sum += bucket[c];
+            bucket[c] = end ? sum : sum - bucket[c];
+        }
+    };
+    auto induce = [&] { //L-types left to right from the placed seeds, then S-types right to left
+        buckets(false);
+        for (int i = 0; i < n; ++i) {
+            int j = sa[i] - 1;
+            if (sa[i] > 0 && !stype[j]) { sa[bucket[s[j]]++] = j; }
+        }
+        buckets(true);
+        for (int i = n-1; i >= 0; --i) {
+            int j = sa[i] - 1;
+            if (sa[i] > 0 && stype[j]) { sa[--bucket[s[j]]] = j; }
+        }
+    };
+    //sort the LMS substrings
+    fill(sa, sa + n, -1);
+    buckets(true);
+    for (int i = 1; i < n; ++i) { if (lms(i)) { sa[--bucket[s[i]]] = i; } }
+    induce();
+    //name them, equal substrings get equal names; the names land in sa[n-n1..n) in text order
+    int n1 = 0;
+    for (int i = 0; i < n; ++i) { if (lms(sa[i])) { sa[n1++] = sa[i]; } }
+    fill(sa + n1, sa + n, -1);
+    int names = 0, prev = -1;
+    for (int i = 0; i < n1; ++i) {
+        int pos = sa[i];
+        bool differs = prev < 0;
+        for (int d = 0; !differs; ++d) {
+            if (s[pos+d] != s[prev+d] || stype[pos+d] != stype[prev+d]) { differs = true; }
+            else if (d > 0 && (lms(pos+d) || lms(prev+d))) { break; }
+        }
+        if (differs) { ++names; prev = pos; }
+        sa[n1 + pos/2] = names - 1; //LMS positions are at least 2 apart
+    }
+    for (int i = n-1, j = n-1; i >= n1; --i) { if (sa[i] >= 0) { sa[j--] = sa[i]; } }
+    //order of the LMS suffixes: directly when all names are unique, else recursively
+    int* s1 = sa + n - n1;
+    if (names < n1) { build(s1, sa, n1, names); }
+    else { for (int i = 0; i < n1; ++i) { sa[s1[i]] = i; } }
+    //seed the buckets with the sorted LMS suffixes and induce the rest
+    for (int i = 1, j = 0; i < n; ++i) { if (lms(i)) { s1[j++] = i; } }
+    for (int i = 0; i < n1; ++i) { sa[i] = s1[sa[i]]; }
+    fill(sa + n1, sa + n, -1);
+    buckets(true);
+    for (int i = n1-1; i >= 0; --i) {
+        int j = sa[i];
+        sa[i] = -1;
+        sa[--bucket[s[j]]] = j;
+    }
+    induce();
+}
+
+// starts of the suffixes of text in lexicographic (unsigned byte) order
+vector<int> order(string_view text) {
+    int n = (int) text.size();
+    vector<int> s (n+1), sa (n+1);
+    for (int i = 0; i < n; ++i) { s[i] = (unsigned char) text[i] + 1; }
+    s[n] = 0;
+    build(s.data(), sa.data(), n+1, sigma+1);
+    sa.erase(sa.begin()); //the sentinel suffix always comes first
+    return sa;
+}
+
+} // namespace sais
+
+// Kasai et al.: lcp[r] = longest common prefix of the suffixes at ranks r-1 and r (lcp[0] = 0);
+// computes in O(n), the height drops by at most one per text position; uses O(n) memory
+vector<int> LongestCommonPrefixes(string_view text, const vector<int>& sa) {
+    int n = (int) text.size();
+    vector<int> rank (n), lcp (n, 0);
+    for (int r = 0; r < n; ++r) { rank[sa[r]] = r; }
+    for (int i = 0, h = 0; i < n; ++i) {
+        if (rank[i] == 0) { h = 0; continue; }
+        int j = sa[rank[i]-1];
+        while (i+h < n && j+h < n && text[i+h] == text[j+h]) { ++h; }
+        lcp[rank[i]] = h;
+        if (h > 0) { --h; }
+    }
+    return lcp;
+}
+
+// suffix array + LCP array over a static corpus, built once and queried many times:
+// the occurrences of a pattern are one contiguous range of ranks, its left end is found by binary
+// search skipping the prefix already shared with both ends of the interval (O(m log n) worst case,
+// close to O(m + log n) in practice) and the range is then walked along the LCP array, O(1) per hit;
+// uses 8n bytes + the text, which is not owned when built in memory (it must outlive the index)
+// and lives inside the index file once saved and loaded back
+class SuffixArray {
+private:
+    static constexpr char magic[8] = {'S', 'A', 'L', 'C', 'P', 'v', '1', '\n'};
+    string_view text;
+    const int* sa = nullptr; //rank -> start of the suffix
+    const int* lcp = nullptr; //rank -> common prefix with the previous rank
+    vector<int> ownSa, ownLcp; //built in memory...
+    unique_ptr<MappedFile> file; //...or viewed inside a loaded index file
+
+    SuffixArray() = default;
+    static size_t padded(size_t n) { return (n + 3) & ~(size_t) 3; } //keeps the int arrays aligned
+    // first rank whose suffix has pattern as a prefix or sorts above it (upper: sorts above it)
+    int bound(string_view pattern, bool upper) const {
+        int n = (int) text.size(), m = (int) pattern.size();
+        int lo = -1, hi = n, lcpLo = 0, lcpHi = 0; //common prefix of pattern with the suffixes at lo and hi
+        while (hi - lo > 1) {
+            int mid = lo + (hi - lo) / 2;
+            int skip = min(lcpLo, lcpHi), k = skip, start = sa[mid];
+            while (k < m && start + k < n && text[start+k] == pattern[k]) { ++k; }
+            STRINGS_COUNT(stats::Engine::SuffixArray, comparisons, k - skip + 1); //the matched bytes and the one deciding
+            bool below = (k == m) ? upper : (start + k == n || (unsigned char) text[start+k] < (unsigned char) pattern[k]);
+            if (below) { lo = mid; lcpLo = k; } else { hi = mid; lcpHi = k; }
+        }
+        return hi;
+    }
+public:
+    explicit SuffixArray(string_view corpus) : text(corpus) {
+        if (corpus.size() >= (size_t) numeric_limits<int>::max()) { throw invalid_argument("corpus too large for 32-bit ranks"); }
+        ownSa = sais::order(text);
+        ownLcp = LongestCommonPrefixes(text, ownSa);
+        sa = ownSa.data();
+        lcp = ownLcp.data();
+    }
+    // maps an index written by save(); pages are faulted in on first use, so startup is O(1)
+    static SuffixArray load(const char* path) {
+        SuffixArray index;
+        index.file = make_unique<MappedFile>(path, MADV_RANDOM);
+        string_view raw = index.file->text();
+        uint64_t n = 0;
+        if (raw.size() >= sizeof(magic) + sizeof(n)) { memcpy(&n, raw.data() + sizeof(magic), sizeof(n)); }
+        size_t header = sizeof(magic) + sizeof(n);
+        if (raw.size() < header || memcmp(raw.data(), magic, sizeof(magic)) != 0 || n >= (uint64_t) numeric_limits<int>::max() ||
+            raw.size() != header + padded(n) + 2 * n * sizeof(int)) {
+            throw runtime_error(string(path) + ": not a suffix array index");
+        }
+        index.text = raw.substr(header, n);
+        index.sa = reinterpret_cast<const int*>(raw.data() + header + padded(n));
+        index.lcp = index.sa + n;
+        return index;
+    }
+    // layout: magic, uint64 n, the text zero-padded to 4 bytes, sa[n], lcp[n] (native 32-bit ints)
+    void save(const char* path) const {
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) { throw system_error(errno, generic_category(), path); }
+        uint64_t n = text.size();
+        char zeros[4] = {};
+        size_t bytes = n * sizeof(int);
+        pair<const void*, size_t> parts[] = {{magic, sizeof(magic)}, {&n, sizeof(n)}, {text.data(), n},
+                                             {zeros, padded(n) - n}, {sa, bytes}, {lcp, bytes}};
+        for (auto [data, size] : parts) {
+            auto p = (const char*) data;
+            while (size > 0) {
+                ssize_t put = write(fd, p, size);
+                if (put < 0 && errno == EINTR) { continue; }
+                if (put < 0) {
+                    int error = errno;
+                    close(fd);
+                    throw system_error(error, generic_category(), path);
+                }
+                p += put;
+                size -= (size_t) put;
+            }
+        }
+        if (close(fd) != 0) { throw system_error(errno, generic_category(), path); }
+    }
+    string_view corpus() const { return text; }
+    bool contains(string_view pattern) const { return count(pattern) > 0; }
+    // computes in two binary searches, independent of the number of hits
+    int count(string_view pattern) const {
+        if (pattern.empty()) { return 0; }
+        STRINGS_TIMER(stats::Engine::SuffixArray);
+        return bound(pattern, true) - bound(pattern, false);
+    }
+    // visit(const Hit&) per hit in suffix order (not by position); may return bool, false stops
+    template <typename Visitor>
+    void scan(string_view pattern, Visitor&& visit) const {
+        int n = (int) text.size(), m = (int) pattern.size();
+        if (m == 0) { return; }
+        STRINGS_TIMER(stats::Engine::SuffixArray);
+        int r = bound(pattern, false);
+        if (r == n || text.compare(sa[r], (size_t) m, pattern) != 0) { return; }
+        do {
+            STRINGS_COUNT(stats::Engine::SuffixArray, hits, 1);
+            if (!Visit(visit, Hit(sa[r], m))) { return; }
+        } while (++r < n && lcp[r] >= m);
+    }
+    // the hits by position, as the scanning matchers report them
+    Match search(string_view pattern) const {
+        vector<Hit> hits;
+        scan(pattern, [&](const Hit& h) { hits.push_back(h); });
+        sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.start < b.start; });
+        return {text, pattern, hits};
+    }
+};
+
+// bit vector with rank in O(1): a cumulative count every 512 bits plus at most 8 popcounts;
+// uses n + n/16 bits
+class RankBits {
+private:
+    vector<uint64_t> words;
+    vector<uint32_t> blocks; //blocks[b]: ones in words[0, 8b)
+public:
+    RankBits() = default;
+    explicit RankBits(size_t n) : words(n/64 + 1, 0) {} //one spare word, so rank(n) stays in bounds
+    void set(size_t i) { words[i >> 6] |= 1ULL << (i & 63); }
+    bool get(size_t i) const { return (words[i >> 6] >> (i & 63)) & 1; }
+    void index() { //after the last set()
+        blocks.assign((words.size() + 7)/8 + 1, 0);
+        for (size_t w = 0; w < words.size(); ++w) { blocks[w/8 + 1] += (uint32_t) __builtin_popcountll(words[w]); }
+        for (size_t b = 1; b < blocks.size(); ++b) { blocks[b] += blocks[b-1]; }
+    }
+    uint32_t rank(size_t i) const { //ones in [0, i)
+        size_t w = i >> 6;
+        uint32_t r = blocks[w >> 3];
+        for (size_t k = w & ~(size_t) 7; k < w; ++k) { r += (uint32_t) __builtin_popcountll(words[k]); }
+        return r + (uint32_t) __builtin_popcountll(words[w] & ((1ULL << (i & 63)) - 1));
+    }
+    size_t bytes() const { return words.size() * sizeof(uint64_t) + blocks.size() * sizeof(uint32_t); }
+};
+
+// FM-index: the Burrows-Wheeler transform of the text in a wavelet matrix (8 levels of RankBits, one
+// per bit of the byte) plus the suffix array entries of every sampleRate-th text position; the text
+// itself is not kept. count() is a backward search of 2m byte ranks = O(m log sigma), each hit is
+// then located in at most sampleRate-1 LF steps of O(log sigma); uses about 1.2n + 4n/sampleRate
+// bytes (1.3n at the default of 32, against 8n + the text for SuffixArray), building needs the full
+// suffix array once
+class FMIndex {
+private:
+    int rows = 0; //n+1, the sentinel suffix included
+    int dollar = 0; //BWT row holding the sentinel, stored as a 0 byte
+    array<int, sigma> first {}; //first row whose suffix starts with byte c (row 0 is the sentinel's)
+    array<RankBits, 8> level; //most significant bit first
+    array<int, 8> zeros {}; //0 bits per level, they move stably in front of the 1s for the next level
+    array<int, sigma> bottom {}; //where the run of byte c starts below the last level
+    RankBits sampled; //rows whose text position is a multiple of sampleRate
+    vector<int> samples; //their positions, in row order
+
+    // LF step: the byte at BWT row r and its occurrences in rows [0, r)
+    pair<unsigned char, int> access(int r) const {
+        int i = r, c = 0;
+        for (int l = 0; l < 8; ++l) {
+            bool bit = level[l].get((size_t) i);
+            int ones = (int) level[l].rank((size_t) i);
+            c = (c << 1) | bit;
+            i = bit ? zeros[l] + ones : i - ones;
+        }
+        return {(unsigned char) c, i - bottom[c] - ((c == 0 && dollar < r) ? 1 : 0)};
+    }
+    int rank(unsigned char c, int r) const { //occurrences of c in BWT rows [0, r)
+        int i = r;
+        for (int l = 0; l < 8; ++l) {
+            int ones = (int) level[l].rank((size_t) i);
+            i = ((c >> (7-l)) & 1) ? zeros[l] + ones : i - ones;
+        }
+        return i - bottom[c] - ((c == 0 && dollar < r) ? 1 : 0);
+    }
+    pair<int, int> range(string_view pattern) const { //rows [lo, hi) whose suffixes start with pattern
+        int lo = 0, hi = rows;
+        for (size_t k = pattern.size(); k-- > 0 && lo < hi;) {
+            auto c = (unsigned char) pattern[k];
+            lo = first[c] + rank(c, lo);
+            hi = first[c] + rank(c, hi);
+        }
+        return {lo, hi};
+    }
+    int locate(int r) const {
+        int steps = 0;
+        for (; !sampled.get((size_t) r); ++steps) {
+            auto [c, k] = access(r);
+            r = first[c] + k;
+        }
+        return samples[sampled.rank((size_t) r)] + steps;
+    }
+public:
+    explicit FMIndex(string_view text, int sampleRate = 32) {
+        if (text.size() >= (size_t) numeric_limits<int>::max()) { throw invalid_argument("corpus too large for 32-bit ranks"); }
+        if (sampleRate < 1) { throw invalid_argument("sample rate must be positive"); }
+        int n = (int) text.size();
+        rows = n + 1;
+        vector<int> sa = sais::order(text);
+        sa.insert(sa.begin(), n);
+        vector<unsigned char> bwt (rows);
+        array<int, sigma> counts {};
+        sampled = RankBits((size_t) rows);
+        for (int r = 0; r < rows; ++r) {
+            if (sa[r] == 0) { dollar = r; }
+            bwt[r] = (sa[r] == 0) ? 0 : (unsigned char) text[sa[r]-1];
+            if (sa[r] < n) { ++counts[(unsigned char) text[sa[r]]]; }
+            if (sa[r] % sampleRate == 0) { sampled.set((size_t) r); samples.push_back(sa[r]); }
+        }
+        sampled.index();
+        for (int c = 0, sum = 1; c < sigma; ++c) { first[c] = sum; sum += counts[c]; }
+        vector<unsigned char> next (rows);
+        for (int l = 0; l < 8; ++l) {
+            level[l] = RankBits((size_t) rows);
+            for (int r = 0; r < rows; ++r) { if ((bwt[r] >> (7-l)) & 1) { level[l].set((size_t) r); } }
+            level[l].index();
+            zeros[l] = rows - (int) level[l].rank((size_t) rows);
+            int z = 0, o = zeros[l]; //stable: 0s first, then 1s, each in their previous order
+            for (int r = 0; r < rows; ++r) { next[((bwt[r] >> (7-l)) & 1) ? o++ : z++] = bwt[r]; }
+            bwt.swap(next);
+        }
+        for (int c = 0; c < sigma; ++c) { //the descent of rank(c, 0)
+            int i = 0;
+            for (int l = 0; l < 8; ++l) {
+                int ones = (int) level[l].rank((size_t) i);
+                i = ((c >> (7-l)) & 1) ? zeros[l] + ones : i - ones;
+            }
+            bottom[c] = i;
+        }
+    }
+    int size() const { return rows - 1; }
+    size_t bytes() const {
+        size_t total = sampled.bytes() + samples.size() * sizeof(int);
+        for (const RankBits& bits : level) { total += bits.bytes(); }
+        return total;
+    }
+    // computes in O(m log sigma), independent of the number of hits
+    int count(string_view pattern) const {
+        if (pattern.empty()) { return 0; }
+        STRINGS_TIMER(stats::Engine::FMIndex);
+        auto [lo, hi] = range(pattern);
+        return max(0, hi - lo);
+    }
+    bool contains(string_view pattern) const { return count(pattern) > 0; }
+    // visit(const Hit&) per hit in suffix order (not by position); may return bool, false stops
+    template <typename Visitor>
+    void scan(string_view pattern, Visitor&& visit) const {
+        if (pattern.empty()) { return; }
+        STRINGS_TIMER(stats::Engine::FMIndex);
+        auto [lo, hi] = range(pattern);
+        for (int r = lo; r < hi; ++r) {
+            STRINGS_COUNT(stats::Engine::FMIndex, hits, 1);
+            if (!Visit(visit, Hit(locate(r), (int) pattern.size()))) { return; }
+        }
+    }
+    // the hits by position, as the scanning matchers report them
+    vector<Hit> search(string_view pattern) const {
+        vector<Hit> hits;
+        scan(pattern, [&](const Hit& h) { hits.push_back(h); });
+        sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.start < b.start; });
+        return hits;
+    }
+};
+
+// parallel search starts here
+
+// fixed set of workers fed from one FIFO queue, so a search never spawns threads per call;
+// a task must not block on another task of the same pool (no nested ParallelSearch from a task);
+// each worker runs init() once before its first task (e.g. numa::pin)
+class ThreadPool {
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex lock;
+    condition_variable ready;
+    bool stopping = false;
+public:
+    explicit ThreadPool(unsigned threads, function<void()> init = nullptr) {
+        for (unsigned t = 0; t < max(1u, threads); ++t) {
+            workers.emplace_back([this, init] {
+                if (init) { init(); }
+                while (true) {
+                    function<void()> task;
+                    {
+                        unique_lock<mutex> guard(lock);
+                        ready.wait(guard, [this] { return stopping || !tasks.empty(); });
+                        if (tasks.empty()) { return; } //stopping and drained
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        ready.notify_all();
+        for (thread& w : workers) { w.join(); }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    unsigned size() const { return (unsigned) workers.size(); }
+    template <typename F>
+    future<void> submit(F f) {
+        auto task = make_shared<packaged_task<void()>>(std::move(f));
+        future<void> done = task->get_future();
+        {
+            lock_guard<mutex> guard(lock);
+            tasks.emplace([task] { (*task)(); });
+        }
+        ready.notify_one();
+        return done;
+    }
+};
+
+// process-wide pool, one worker per hardware thread, created on first use
+ThreadPool& SharedPool() {
+    static ThreadPool pool(thread::hardware_concurrency());
+    return pool;
+}
+
+// splits base into segments [lo, hi) searched as [lo, hi+m-1), i.e. overlapping by m-1 bytes, so a
+// match straddling a border is seen whole by the segment it starts in; hits starting at or past hi
+// belong to the next segment and are dropped, then the per-segment lists (each ordered by start)
+// are concatenated in segment order, which keeps the result globally ordered;
+// computes in the matcher's own bound over n/threads bytes per worker; uses O(h) memory
+vector<Hit> ParallelSearch(string_view base, string_view pattern, Matcher algo = KnuthMorrisPratt,
+                           ThreadPool& pool = SharedPool(), size_t minSegment = 1 << 16) {
+    size_t n = base.size(), m = pattern.size();
+    if (m == 0 || n < m) { return {}; }
+    //a few segments per worker evens out uneven hit densities
+    size_t segments = max<size_t>(1, min<size_t>(4 * (size_t) pool.size(), n / minSegment));
+    size_t step = (n + segments - 1) / segments;
+    vector<vector<Hit>> parts(segments);
+    vector<future<void>> done;
+    for (size_t k = 0; k < segments; ++k) {
+        done.push_back(pool.submit([&, k] {
+            size_t lo = k * step, hi = min(n, lo + step);
+            if (lo >= hi) { return; }
+            Match part = algo(base.substr(lo, hi - lo + m - 1), pattern);
+            for (const Hit& h : part.getHits()) {
+                if ((size_t) h.start >= hi - lo) { continue; } //owned by segment k+1
+                parts[k].emplace_back((Offset) lo + h.start, h.length, h.accuracy, h.id);
+            }
+        }));
+    }
+    for (future<void>& f : done) { f.wait(); } //the tasks use parts until the last one is done
+    for (future<void>& f : done) { f.get(); } //rethrows a worker's exception
+    vector<Hit> hits;
+    size_t total = 0;
+    for (const vector<Hit>& p : parts) { total += p.size(); }
+    hits.reserve(total);
+    for (vector<Hit>& p : parts) { hits.insert(hits.end(), p.begin(), p.end()); }
+    return hits;
+}
+
+// sharded search starts here
+// (a corpus too large for one socket: every NUMA node gets its own shards and its own pinned
+// workers, so a query reads local memory only and the nodes never contend for each other's
+// memory controllers; no libnuma: the topology comes from sysfs, placement from first touch)
+
+namespace numa {
+
+// the cpus of one node that this process may run on
+struct Node {
+    int id;
+    vector<int> cpus;
+};
+
+// "0-3,8,10-11" as in /sys/devices/system/node/node*/cpulist
+vector<int> cpuList(string_view list) {
+    vector<int> cpus;
+    const char* p = list.data();
+    const char* end = p + list.size();
+    while (p < end) {
+        int lo = 0, hi = 0;
+        auto r = from_chars(p, end, lo);
+        if (r.ec != errc()) { break; }
+        p = r.ptr;
+        hi = lo;
+        if (p < end && *p == '-') {
+            r = from_chars(p + 1, end, hi);
+            if (r.ec != errc()) { break; }
+            p = r.ptr;
+        }
+        for (int c = lo; c <= hi; ++c) { cpus.push_back(c); }
+        if (p == end || *p != ',') { break; } //the trailing newline
+        ++p;
+    }
+    return cpus;
+}
+
+// nodes by id, each with the cpus of our affinity mask; memory-only nodes and nodes outside the
+// mask are left out; without sysfs (other kernels, some containers) one node holds every cpu
+vector<Node> discover() {
+    vector<Node> found;
+    vector<int> allowed;
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int c = 0; c < CPU_SETSIZE; ++c) { if (CPU_ISSET(c, &mask)) { allowed.push_back(c); } }
+    }
+    error_code error;
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator("/sys/devices/system/node", error)) {
+        string name = entry.path().filename().string();
+        if (name.size() <= 4 || name.compare(0, 4, "node") != 0 ||
+            !all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; })) { continue; }
+        int fd = open((entry.path() / "cpulist").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) { continue; }
+        char list[4096];
+        ssize_t got = read(fd, list, sizeof(list));
+        close(fd);
+        Node node {stoi(name.substr(4)), {}};
+        for (int c : cpuList(string_view(list, (size_t) max<ssize_t>(got, 0)))) {
+            if (binary_search(allowed.begin(), allowed.end(), c)) { node.cpus.push_back(c); }
+        }
+        if (!node.cpus.empty()) { found.push_back(std::move(node)); }
+    }
+    sort(found.begin(), found.end(), [](const Node& a, const Node& b) { return a.id < b.id; });
+#endif
+    if (found.empty()) {
+        if (allowed.empty()) {
+            for (int c = 0; c < (int) max(1u, thread::hardware_concurrency()); ++c) { allowed.push_back(c); }
+        }
+        found.push_back({0, allowed});
+    }
+    return found;
+}
+
+// the machine's nodes, read once
+const vector<Node>& nodes() {
+    static const vector<Node> topology = discover();
+    return topology;
+}
+
+// binds the calling thread to cpus; false where affinity is unsupported or refused
+bool pin(const vector<int>& cpus) {
+#ifdef __linux__
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int c : cpus) { if (c < CPU_SETSIZE) { CPU_SET(c, &mask); } }
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
+
+}
+
+// a corpus cut into shards that each live on one NUMA node: a shard's bytes (and its suffix array,
+// when indexed) are written by a worker pinned to that node, so the kernel's first-touch policy
+// places them in local memory, and only that node's workers search them; consecutive shards
+// overlap by maxPattern-1 bytes, so a hit straddling a border is found whole by the shard it
+// starts in (as in ParallelSearch); one shard per node by default, indexed shards are split
+// further to stay below the 2 GiB of 32-bit ranks, so the corpus as a whole may exceed it
+class ShardedCorpus {
+private:
+    struct Shard {
+        Offset offset = 0; //corpus offset of text[0]
+        size_t owned = 0; //hits starting in text[0, owned) belong to this shard
+        int node = 0; //index into numa::nodes()
+        unique_ptr<HugeBuffer> memory; //the text, node-local (loaded indexes map theirs instead)
+        unique_ptr<SuffixArray> index;
+        string_view text; //owned bytes plus the overlap, clipped at the end of the corpus
+    };
+    vector<unique_ptr<ThreadPool>> pools; //one per node
+    vector<Shard> shards;
+    size_t overlap = 0, length = 0;
+    bool indexed = false;
+
+    ShardedCorpus() = default;
+    void startPools() {
+        for (const numa::Node& node : numa::nodes()) {
+            pools.push_back(make_unique<ThreadPool>((unsigned) node.cpus.size(), [cpus = node.cpus] { numa::pin(cpus); }));
+        }
+    }
+    // place(shard) for every shard on a worker of its node; waits for all, then rethrows the first error
+    template <typename F>
+    void onNodes(F place) {
+        vector<future<void>> done;
+        for (Shard& s : shards) { done.push_back(pools[s.node]->submit([&place, &s] { place(s); })); }
+        for (future<void>& f : done) { f.wait(); }
+        for (future<void>& f : done) { f.get(); }
+    }
+    // a copy of text in fresh local memory; runs on the shard's node
+    static void localize(Shard& s, string_view text) {
+        s.memory = make_unique<HugeBuffer>(text.size());
+        memcpy(s.memory->data(), text.data(), text.size());
+        s.text = string_view(s.memory->data(), text.size());
+    }
+    static void put(const string& path, string_view data) {
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) { throw system_error(errno, generic_category(), path); }
+        while (!data.empty()) {
+            ssize_t w = write(fd, data.data(), data.size());
+            if (w < 0 && errno == EINTR) { continue; }
+            if (w < 0) {
+                int error = errno;
+                close(fd);
+                throw system_error(error, generic_category(), path);
+            }
+            data.remove_prefix((size_t) w);
+        }
+        if (close(fd) != 0) { throw system_error(errno, generic_category(), path); }
+    }
+public:
+    // shards = 0: one per node; throws invalid_argument for an indexed maxPattern of 2 GiB or more
+    explicit ShardedCorpus(string_view corpus, bool index = false, size_t maxPattern = 1 << 12, int count = 0)
+        : overlap(max<size_t>(maxPattern, 1) - 1), length(corpus.size()), indexed(index) {
+        startPools();
+        size_t n = corpus.size(), parts = (count > 0) ? (size_t) count : pools.size();
+        if (indexed) {
+            size_t limit = (size_t) numeric_limits<int>::max();
+            if (overlap >= limit) { throw invalid_argument("corpus too large for 32-bit ranks"); }
+            parts = max(parts, (n + limit - overlap - 1) / (limit - overlap)); //owned+overlap < limit
+        }
+        if (n == 0) { return; }
+        size_t step = (n + parts - 1) / parts;
+        for (size_t lo = 0, k = 0; lo < n; lo += step, ++k) {
+            Shard s;
+            s.offset = (Offset) lo;
+            s.owned = min(step, n - lo);
+            s.node = (int) (k % pools.size());
+            shards.push_back(std::move(s));
+        }
+        onNodes([&](Shard& s) {
+            localize(s, corpus.substr((size_t) s.offset, s.owned + overlap));
+            if (indexed) { s.index = make_unique<SuffixArray>(s.text); }
+        });
+    }
+    // maps a directory written by save(); the shards go to the nodes they were saved for, modulo
+    // the nodes of this machine; indexes are mapped and fault their pages in from the node's own
+    // workers, raw shards are copied into local memory; throws runtime_error for a bad manifest
+    static ShardedCorpus load(const string& dir) {
+        string path = dir + "/manifest";
+        MappedFile file(path.c_str());
+        string_view rest = file.text();
+        auto token = [&] {
+            size_t from = rest.find_first_not_of(" \n");
+            if (from == string_view::npos) { throw runtime_error(path + ": not a shard manifest"); }
+            size_t to = min(rest.find_first_of(" \n", from), rest.size());
+            string_view word = rest.substr(from, to - from);
+            rest.remove_prefix(to);
+            return word;
+        };
+        auto number = [&] {
+            string_view word = token();
+            unsigned long long v = 0;
+            auto r = from_chars(word.data(), word.data() + word.size(), v);
+            if (r.ec != errc() || r.ptr != word.data() + word.size()) { throw runtime_error(path + ": not a shard manifest"); }
+            return (size_t) v;
+        };
+        ShardedCorpus corpus;
+        if (token() != "shards" || token() != "v1") { throw runtime_error(path + ": not a shard manifest"); }
+        string_view kind = token();
+        if (kind != "text" && kind != "sa") { throw runtime_error(path + ": not a shard manifest"); }
+        corpus.indexed = kind == "sa";
+        corpus.overlap = number();
+        corpus.length = number();
+        size_t count = number();
+        corpus.startPools();
+        vector<string> files;
+        for (size_t k = 0; k < count; ++k) {
+            Shard s;
+            s.offset = (Offset) number();
+            s.owned = number();
+            s.node = (int) (number() % corpus.pools.size());
+            if ((size_t) s.offset + s.owned > corpus.length) { throw runtime_error(path + ": not a shard manifest"); }
+            files.push_back(dir + "/" + string(token()));
+            corpus.shards.push_back(std::move(s));
+        }
+        corpus.onNodes([&](Shard& s) {
+            const string& name = files[(size_t) (&s - corpus.shards.data())];
+            if (corpus.indexed) {
+                s.index = make_unique<SuffixArray>(SuffixArray::load(name.c_str()));
+                s.text = s.index->corpus();
+            } else {
+                MappedFile raw(name.c_str());
+                localize(s, raw.text());
+            }
+            if (s.text.size() != min(s.owned + corpus.overlap, corpus.length - (size_t) s.offset)) {
+                throw runtime_error(name + ": shard does not match the manifest");
+            }
+        });
+        return corpus;
+    }
+    // dir/manifest: "shards v1 <text|sa> <overlap> <corpus bytes> <shards>", then one line
+    // "<offset> <owned> <node> <file>" per shard; a shard file is its text, overlap included, or
+    // its SuffixArray::save(); creates dir if needed
+    void save(const string& dir) const {
+        filesystem::create_directories(dir);
+        string manifest = string("shards v1 ") + (indexed ? "sa " : "text ") + to_string(overlap) + " " +
+                          to_string(length) + " " + to_string(shards.size()) + "\n";
+        for (size_t k = 0; k < shards.size(); ++k) {
+            const Shard& s = shards[k];
+            string name = "shard-" + to_string(k) + (indexed ? ".sa" : ".txt");
+            if (indexed) { s.index->save((dir + "/" + name).c_str()); } else { put(dir + "/" + name, s.text); }
+            manifest += to_string(s.offset) + " " + to_string(s.owned) + " " + to_string(s.node) + " " + name + "\n";
+        }
+        put(dir + "/manifest", manifest); //last, so a torn save is not loadable
+    }
+    size_t size() const { return length; }
+    size_t shardCount() const { return shards.size(); }
+    // hits by corpus offset, from every shard at once: each node's workers search its own shards,
+    // raw ones in segments (see ParallelSearch), indexed ones whole; throws invalid_argument for a
+    // pattern longer than maxPattern; computes in the local matcher's bound over n/cores bytes
+    // per worker (indexed: O(m log n + h) per shard); uses O(h) memory
+    vector<Hit> search(string_view pattern) const {
+        size_t m = pattern.size();
+        if (m == 0) { return {}; }
+        if (m > overlap + 1) { throw invalid_argument("pattern longer than the shard overlap"); }
+        unique_ptr<const CompiledPattern<compiled::BoyerMoore>> compiled;
+        if (!indexed) { compiled = make_unique<const CompiledPattern<compiled::BoyerMoore>>(pattern); }
+        struct Part {
+            const Shard* shard;
+            size_t lo, hi; //owned bytes of the shard searched by this task
+        };
+        vector<Part> work;
+        for (const Shard& s : shards) {
+            size_t segments = indexed ? 1 : max<size_t>(1, min<size_t>(2 * (size_t) pools[s.node]->size(), s.owned >> 16));
+            size_t step = (s.owned + segments - 1) / segments;
+            for (size_t lo = 0; lo < s.owned; lo += step) { work.push_back({&s, lo, min(s.owned, lo + step)}); }
+        }
+        vector<vector<Hit>> parts(work.size());
+        vector<future<void>> done;
+        for (size_t k = 0; k < work.size(); ++k) {
+            done.push_back(pools[work[k].shard->node]->submit([&, k] {
+                const Shard& s = *work[k].shard;
+                size_t lo = work[k].lo, hi = work[k].hi;
+                vector<Hit>& hits = parts[k];
+                if (indexed) {
+                    s.index->scan(pattern, [&](const Hit& h) {
+                        if ((size_t) h.start < s.owned) { hits.emplace_back(s.offset + h.start, h.length, h.accuracy, h.id); }
+                    });
+                    sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.start < b.start; });
+                    return;
+                }
+                compiled->forEach(s.text.substr(lo, hi - lo + m - 1), [&](const Hit& h) {
+                    if ((size_t) h.start < hi - lo) { hits.emplace_back(s.offset + (Offset) lo + h.start, h.length, h.accuracy, h.id); }
+                });
+            }));
+        }
+        for (future<void>& f : done) { f.wait(); } //the tasks use work and parts until the last one is done
+        for (future<void>& f : done) { f.get(); }
+        vector<Hit> hits;
+        size_t total = 0;
+        for (const vector<Hit>& p : parts) { total += p.size(); }
+        hits.reserve(total);
+        for (vector<Hit>& p : parts) { hits.insert(hits.end(), p.begin(), p.end()); }
+        return hits;
+    }
+};
+
+// pipelined file search starts here
+// (many files, e.g. a directory of logs, at disk speed: one reader thread fills a ring of
+// page-aligned buffers, the pool searches the filled ones in any order, and the caller's thread
+// emits their hits in ring order, so reading, searching and output overlap; a buffer is only
+// refilled once its hits are out, which holds the reader back when the workers or the output
+// fall behind)
+
+// every regular file under the given paths (directories recursively, each sorted by name)
+vector<string> ListFiles(const vector<string>& paths) {
+    vector<string> files;
+    for (const string& p : paths) {
+        if (!filesystem::is_directory(p)) { files.push_back(p); continue; }
+        vector<string> inside;
+        for (const auto& e : filesystem::recursive_directory_iterator(p, filesystem::directory_options::skip_permission_denied)) {
+            if (e.is_regular_file()) { inside.push_back(e.path().string()); }
+        }
+        sort(inside.begin(), inside.end());
+        files.insert(files.end(), inside.begin(), inside.end());
+    }
+    return files;
+}
+
+// visit(size_t file, const Hit&) for the hits of pattern in files[0], files[1]..., in order within
+// each file; a chunk of a file is searched together with the m-1 bytes carried from its previous
+// chunk (see SearchFile), so the chunks of one file go to different workers; the visitor runs on
+// the calling thread; throws system_error for a file that cannot be read, after the rest of the
+// pipeline has stopped; uses O(buffers*(block+m)) memory plus the hits of the buffers in flight
+template <typename Algo = compiled::BoyerMoore, typename Visitor>
+void SearchFiles(const vector<string>& files, string_view pattern, Visitor&& visit, size_t block = 1 << 20,
+                 int buffers = 0, ThreadPool& pool = SharedPool()) {
+    if (pattern.empty() || files.empty()) { return; }
+    const CompiledPattern<Algo> compiled(pattern);
+    constexpr size_t page = 4096;
+    size_t carry = pattern.size() - 1;
+    size_t capacity = (carry + block + page - 1) / page * page;
+    if (buffers <= 0) { buffers = 2 * (int) pool.size() + 2; }
+    buffers = max(buffers, 2); //the carried bytes come from the previous buffer
+    enum State { Free, Filled, Searched };
+    struct Buffer {
+        char* data = nullptr; //inside memory
+        State state = Free;
+        size_t file = 0, length = 0;
+        Offset offset = 0; //file offset of data[0]
+        vector<Hit> hits; //relative to data
+        exception_ptr error;
+    };
+    vector<Buffer> ring(buffers);
+    HugeBuffer memory((size_t) buffers * capacity); //one region, so even 1 MiB blocks share huge pages
+    for (int k = 0; k < buffers; ++k) { ring[k].data = memory.data() + (size_t) k * capacity; }
+    mutex lock;
+    condition_variable changed;
+    size_t filled = numeric_limits<size_t>::max(); //buffers the reader has filled, max() while it runs
+    int searching = 0; //tasks submitted and not yet finished
+    bool stopping = false; //the caller gave up
+    exception_ptr readError;
+
+    thread reader([&] {
+        size_t seq = 0;
+        try {
+            for (size_t f = 0; f < files.size(); ++f) {
+                int fd = open(files[f].c_str(), O_RDONLY | O_CLOEXEC);
+                if (fd < 0) { throw system_error(errno, generic_category(), files[f]); }
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+                const Buffer* previous = nullptr; //of the same file, holds the carried bytes
+                Offset consumed = 0; //bytes of the file read so far
+                while (true) {
+                    Buffer& b = ring[seq % buffers];
+                    {
+                        unique_lock<mutex> guard(lock);
+                        changed.wait(guard, [&] { return b.state == Free || stopping; });
+                        if (stopping) { close(fd); return; }
+                    }
+                    size_t kept = 0;
+                    if (previous != nullptr) { //only this thread writes buffers, so the tail is still intact
+                        kept = min(carry, previous->length);
+                        memcpy(b.data, previous->data + previous->length - kept, kept);
+                    }
+                    size_t got = kept;
+                    while (got < kept + block) {
+                        ssize_t r = read(fd, b.data + got, kept + block - got);
+                        if (r < 0 && errno == EINTR) { continue; }
+                        if (r < 0) { int e = errno; close(fd); throw system_error(e, generic_category(), files[f]); }
+                        if (r == 0) { break; }
+                        got += (size_t) r;
+                    }
+                    if (got == kept) { break; } //the end of this file
+                    b.file = f;
+                    b.length = got;
+                    b.offset = consumed - (Offset) kept;
+                    b.hits.clear();
+                    {
+                        lock_guard<mutex> guard(lock);
+                        b.state = Filled;
+                        ++searching;
+                    }
+                    pool.submit([&, slot = &b] {
+                        try { compiled.search(string_view(slot->data, slot->length), slot->hits); }
+                        catch (...) { slot->error = current_exception(); }
+                        lock_guard<mutex> guard(lock);
+                        slot->state = Searched;
+                        --searching;
+                        changed.notify_all();
+                    });
+                    consumed += (Offset) (got - kept);
+                    previous = &b;
+                    ++seq;
+                }
+                close(fd);
+            }
+        } catch (...) { readError = current_exception(); }
+        lock_guard<mutex> guard(lock);
+        filled = seq;
+        changed.notify_all();
+    });
+    auto stop = [&] { //waits for the reader and every task, nothing may touch the ring afterwards
+        {
+            unique_lock<mutex> guard(lock);
+            stopping = true;
+            changed.notify_all();
+        }
+        reader.join();
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&] { return searching == 0; });
+    };
+    try {
+        for (size_t seq = 0; ; ++seq) {
+            Buffer& b = ring[seq % buffers];
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, [&] { return b.state == Searched || filled == seq; });
+                if (b.state != Searched) { break; } //the reader is done and so is the output
+            }
+            if (b.error) { rethrow_exception(b.error); }
+            for (const Hit& h : b.hits) { visit(b.file, Hit(b.offset + h.start, h.length, h.accuracy, h.id)); }
+            lock_guard<mutex> guard(lock);
+            b.state = Free;
+            changed.notify_all();
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+    stop();
+    if (readError) { rethrow_exception(readError); }
+}
+
+// batch search starts here
+// (many short records against one compiled pattern or AhoCorasick set: no Match, no copy and no
+// table rebuild per record, and the hits go to one set of reusable columns)
+
+// hit k is record[k], start[k] (relative to the record), length[k] and the pattern id[k]
+struct BatchHits {
+    vector<size_t> record;
+    vector<Offset> start;
+    vector<int> length, id;
+    size_t size() const { return record.size(); }
+    void clear() { record.clear(); start.clear(); length.clear(); id.clear(); }
+    void add(size_t r, const Hit& h) {
+        record.push_back(r);
+        start.push_back(h.start);
+        length.push_back(h.length);
+        id.push_back(h.id);
+    }
+};
+
+// visit(const Hit&) for the hits of a CompiledPattern or of a pattern set, in order of their end
+template <typename Searcher, typename Visitor>
+void EachHit(const Searcher& searcher, string_view base, Visitor&& visit) {
+    if constexpr (is_same_v<Searcher, AhoCorasick> || is_same_v<Searcher, RabinKarpSet>) { searcher.scan(base, visit); }
+    else { searcher.forEach(base, visit); }
+}
+
+// records laid out back to back in one buffer, record r = buffer[offsets[r], offsets[r+1]):
+// the whole buffer is scanned in a single pass, so every vector step of the SIMD filter covers
+// several short records at once; hits are mapped to the record of their last byte by a
+// forward-only cursor and dropped if they start in an earlier one; appends to out
+template <typename Searcher>
+void SearchBatch(string_view buffer, const vector<Offset>& offsets, const Searcher& searcher, BatchHits& out) {
+    if (offsets.size() < 2) { return; }
+    size_t records = offsets.size() - 1, r = 0;
+    string_view all = buffer.substr((size_t) offsets[0], (size_t) (offsets[records] - offsets[0]));
+    EachHit(searcher, all, [&](const Hit& h) {
+        Offset s = offsets[0] + h.start, last = s + h.length - 1;
+        while (offsets[r+1] <= last) { ++r; }
+        if (s >= offsets[r]) { out.add(r, Hit(s - offsets[r], h.length, h.accuracy, h.id)); }
+    });
+}
+
+// records anywhere in memory: one scan per record, still without per-record setup; appends to out
+template <typename Searcher>
+void SearchBatch(const vector<string_view>& records, const Searcher& searcher, BatchHits& out) {
+    for (size_t r = 0; r < records.size(); ++r) {
+        EachHit(searcher, records[r], [&](const Hit& h) { out.add(r, h); });
+    }
+}
+
+// bulk multi-pattern search starts here
+// (a large text against a set of patterns; built with -DSTRINGS_GPU and gpu.cu (see README), a
+// CUDA Shift-Or kernel takes the text in double-buffered pinned blocks, everywhere else, and for
+// patterns the kernel cannot hold, AhoCorasick runs on the CPU; the hits are the same either way)
+
+enum class Backend { Auto, Cpu, Gpu };
+
+bool GpuAvailable() {
+#ifdef STRINGS_GPU
+    return gpu::available();
+#else
+    return false;
+#endif
+}
+
+// hits of every pattern tagged with its id, sorted by start then id; Backend::Gpu throws
+// runtime_error when no device can take the patterns, Backend::Auto falls back to the CPU
+vector<Hit> BulkSearch(string_view text, const vector<string>& patterns, Backend backend = Backend::Auto) {
+    bool device = false;
+#ifdef STRINGS_GPU
+    device = backend != Backend::Cpu && !text.empty() && gpu::available() && gpu::fits(patterns);
+#endif
+    if (backend == Backend::Gpu && !device) { throw runtime_error("no CUDA device for these patterns"); }
+    vector<Hit> hits;
+#ifdef STRINGS_GPU
+    if (device) {
+        for (const gpu::Found& f : gpu::scan(text.data(), text.size(), patterns)) {
+            int m = (int) patterns[f.id].size();
+            hits.emplace_back(f.end - m + 1, m, 1.0f, f.id);
+        }
+    }
+#endif
+    if (!device) { hits = AhoCorasick(patterns).search(text); }
+    sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.start != b.start ? a.start < b.start : a.id < b.id; });
+    return hits;
+}
+
+// algorithm selection starts here
+
+enum class Algorithm { Naive, RabinKarp, KnuthMorrisPratt, BoyerMoore, Horspool, Sunday, SimdFilter };
+
+const char* Name(Algorithm a) {
+    switch (a) {
+        case Algorithm::Naive: return "Naive";
+        case Algorithm::RabinKarp: return "RabinKarp";
+        case Algorithm::KnuthMorrisPratt: return "KnuthMorrisPratt";
+        case Algorithm::BoyerMoore: return "BoyerMoore";
+        case Algorithm::Horspool: return "Horspool";
+        case Algorithm::Sunday: return "Sunday";
+        case Algorithm::SimdFilter: return "SimdFilter";
+    }
+    return "?";
+}
+
+Matcher MatcherOf(Algorithm a) {
+    switch (a) {
+        case Algorithm::Naive: return Naive;
+        case Algorithm::RabinKarp: return RabinKarp;
+        case Algorithm::KnuthMorrisPratt: return KnuthMorrisPratt;
+        case Algorithm::BoyerMoore: return BoyerMoore;
+        case Algorithm::Horspool: return Horspool;
+        case Algorithm::Sunday: return Sunday;
+        case Algorithm::SimdFilter: return SimdFilter;
+    }
+    return KnuthMorrisPratt;
+}
+
+// crossover points of the selection heuristics; the defaults are conservative (on one AVX-512 core
+// strings --bench has the SIMD filter ahead up to m=4096 on text), strings --calibrate [file]
+// measures longPattern for the target box and corpus
+struct Thresholds {
+    size_t smallText = 64; //below this no table or statistic pays off, the table-free SIMD filter runs
+    size_t longPattern = 256; //above this the filter's O(nm) worst case is traded for shift-based scans
+    size_t smallAlphabet = 4; //distinct pattern bytes up to this make bad-char shifts short (DNA)
+    size_t parallelText = 8 << 20; //from here on the text is split across SharedPool()
+};
+
+// what Search() decided and why, for logging
+struct Plan {
+    Algorithm algo = Algorithm::KnuthMorrisPratt;
+    bool parallel = false;
+    size_t n = 0, m = 0;
+    size_t alphabet = 0; //distinct bytes in the pattern
+    size_t period = 0; //smallest p with pattern[i] == pattern[i+p], m - (KMP border of the whole pattern)
+    const char* reason = "";
+};
+
+ostream& operator<<(ostream& os, const Plan& p) {
+    return os << Name(p.algo) << (p.parallel ? " (parallel)" : "") << ": " << p.reason
+              << " [n=" << p.n << ", m=" << p.m << ", alphabet=" << p.alphabet << ", period=" << p.period << "]";
+}
+
+// picks an engine from O(m) pattern statistics plus the text size;
+// periodic means period <= m/2, i.e. the pattern overlaps itself at least halfway
+Plan Choose(string_view base, string_view pattern, const Thresholds& t = Thresholds(),
+            pmr::memory_resource* scratch = pmr::get_default_resource()) {
+    Plan p;
+    p.n = base.size();
+    p.m = pattern.size();
+    if (p.m == 0 || p.m > p.n) { p.reason = "nothing to search"; return p; }
+    if (p.n < t.smallText) { p.algo = Algorithm::SimdFilter; p.reason = "text too small to amortize any table"; return p; }
+    array<bool, sigma> seen {};
+    for (char c : pattern) { seen[(unsigned char) c] = true; }
+    p.alphabet = (size_t) count(seen.begin(), seen.end(), true);
+    p.period = p.m - (size_t) compiled::KnuthMorrisPratt(pattern, scratch).prefix[p.m-1];
+    p.parallel = p.n >= t.parallelText && SharedPool().size() > 1;
+    bool periodic = 2 * p.period <= p.m;
+    if (periodic && p.m <= t.longPattern) { p.algo = Algorithm::KnuthMorrisPratt; p.reason = "periodic pattern, failure links keep it linear"; }
+    else if (periodic) { p.algo = Algorithm::BoyerMoore; p.reason = "long periodic pattern, the Galil rule keeps it linear"; }
+    else if (p.m <= t.longPattern) { p.algo = Algorithm::SimdFilter; p.reason = "short pattern, first/last-byte filter"; }
+    else if (p.alphabet <= t.smallAlphabet) { p.algo = Algorithm::BoyerMoore; p.reason = "long pattern over a small alphabet, good-suffix shifts"; }
+    else { p.algo = Algorithm::Horspool; p.reason = "long pattern over a large alphabet, bad-char shifts"; }
+    return p;
+}
+
+// front end for callers that do not care which matcher runs; pass decision to log the choice
+Match Search(string_view base, string_view pattern, const Thresholds& t = Thresholds(), Plan* decision = nullptr) {
+    Plan p = Choose(base, pattern, t);
+    if (decision != nullptr) { *decision = p; }
+    if (p.parallel) { return {base, pattern, ParallelSearch(base, pattern, MatcherOf(p.algo))}; }
+    return MatcherOf(p.algo)(base, pattern);
+}
+
+// case-insensitive Search(): the same plan, run by the engines that fold (a Naive, Rabin-Karp,
+// Horspool or Sunday pick becomes Boyer-Moore); the statistics are those of the unfolded pattern
+Match SearchCaseless(string_view base, string_view pattern, const Thresholds& t = Thresholds(), Plan* decision = nullptr) {
+    Plan p = Choose(base, pattern, t);
+    if (decision != nullptr) { *decision = p; }
+    Matcher algo = (p.algo == Algorithm::KnuthMorrisPratt) ? CaselessKnuthMorrisPratt :
+                   (p.algo == Algorithm::SimdFilter) ? CaselessSimdFilter : CaselessBoyerMoore;
+    if (p.parallel) { return {base, pattern, ParallelSearch(base, pattern, algo)}; }
+    return algo(base, pattern);
+}
+
+// runs f(policy) with the compiled policy of a, so one-shot modes can use any sink
+template <typename F>
+void WithPolicy(Algorithm a, string_view pattern, F&& f, pmr::memory_resource* scratch = pmr::get_default_resource()) {
+    switch (a) {
+        case Algorithm::Naive: f(Compile<compiled::Naive>(pattern, scratch)); return;
+        case Algorithm::RabinKarp: f(Compile<compiled::RabinKarp>(pattern, scratch)); return;
+        case Algorithm::KnuthMorrisPratt: f(Compile<compiled::KnuthMorrisPratt>(pattern, scratch)); return;
+        case Algorithm::BoyerMoore: f(Compile<compiled::BoyerMoore>(pattern, scratch)); return;
+        case Algorithm::Horspool: f(Compile<compiled::Horspool>(pattern, scratch)); return;
+        case Algorithm::Sunday: f(Compile<compiled::Sunday>(pattern, scratch)); return;
+        case Algorithm::SimdFilter: f(Compile<compiled::SimdFilter>(pattern, scratch)); return;
+    }
+}
+
+// Search() on a per-thread context: the same choice, but never split across threads and
+// allocation-free once ctx has warmed up; the hits live in ctx until its next query
+const vector<Hit>& Search(string_view base, string_view pattern, SearchContext& ctx, const Thresholds& t = Thresholds()) {
+    pmr::memory_resource* scratch = ctx.begin();
+    vector<Hit>& hits = ctx.results();
+    if (pattern.empty() || pattern.size() > base.size()) { return hits; }
+    int m = (int) pattern.size();
+    auto collect = [&](Offset s) { hits.emplace_back(s, m); return true; };
+    WithPolicy(Choose(base, pattern, t, scratch).algo, pattern, [&](const auto& algo) { Scan(algo, base, pattern, collect); }, scratch);
+    return hits;
+}
+
+// one-shot count-only and early-exit modes on top of Choose(); the ones that stop early never
+// split the text across threads, the first hit is usually close
+template <typename Sink>
+void ScanAny(string_view base, string_view pattern, const Thresholds& t, Sink& sink) {
+    if (pattern.empty() || pattern.size() > base.size()) { return; }
+    WithPolicy(Choose(base, pattern, t).algo, pattern, [&](const auto& algo) { Scan(algo, base, pattern, sink); });
+}
+
+bool Contains(string_view base, string_view pattern, const Thresholds& t = Thresholds()) {
+    bool found = false;
+    auto sink = [&](Offset) { found = true; return false; };
+    ScanAny(base, pattern, t, sink);
+    return found;
+}
+
+size_t Count(string_view base, string_view pattern, const Thresholds& t = Thresholds()) {
+    size_t c = 0;
+    auto sink = [&](Offset) { ++c; return true; };
+    ScanAny(base, pattern, t, sink);
+    return c;
+}
+
+Offset FindFirst(string_view base, string_view pattern, const Thresholds& t = Thresholds()) { //-1 if there is none
+    Offset first = -1;
+    auto sink = [&](Offset s) { first = s; return false; };
+    ScanAny(base, pattern, t, sink);
+    return first;
+}
+
+// callback delivery through the front end, see CompiledPattern::forEach
+template <typename Visitor>
+void ForEachHit(string_view base, string_view pattern, Visitor&& visit, const Thresholds& t = Thresholds()) {
+    int m = (int) pattern.size();
+    auto sink = [&](Offset s) { return Visit(visit, Hit(s, m)); };
+    ScanAny(base, pattern, t, sink);
+}
+
+vector<Hit> FindN(string_view base, string_view pattern, size_t k, const Thresholds& t = Thresholds()) {
+    vector<Hit> hits;
+    if (k == 0) { return hits; }
+    int m = (int) pattern.size();
+    auto sink = [&](Offset s) { hits.emplace_back(s, m); return --k > 0; };
+    ScanAny(base, pattern, t, sink);
+    return hits;
+}
+
+// benchmark starts here
+// (strings --bench [bytes] [file]: every engine over synthetic corpora, the lorem text tiled up and
+// optionally a real file, sweeping pattern lengths and hit densities; reports GB/s, ns/hit and,
+// built with -DSTRINGS_ALLOCS, allocations per search, one line per configuration)
+
+namespace bench {
+
+#ifdef STRINGS_ALLOCS
+atomic<size_t> allocations {0}; //counted by the global operator new below
+#endif
+
+// allocations so far, process wide; only -DSTRINGS_ALLOCS builds replace operator new to count
+// them (one shared counter on every allocation of every thread), other builds leave the allocator
+// alone and the column shows -
+constexpr bool countsAllocations() {
+#ifdef STRINGS_ALLOCS
+    return true;
+#else
+    return false;
+#endif
+}
+size_t allocated() {
+#ifdef STRINGS_ALLOCS
+    return allocations.load(memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+// kind: random (printable), dna (ACGT), periodic (abc repeated), english (sample tiled), binary (all bytes)
+string corpus(string_view kind, size_t n, string_view sample, mt19937_64& rng) {
+    string text(n, '\0');
+    for (size_t i = 0; i < n; ++i) {
+        if (kind == "random") { text[i] = (char) (' ' + rng() % 95); }
+        else if (kind == "dna") { text[i] = "ACGT"[rng() % 4]; }
+        else if (kind == "periodic") { text[i] = "abc"[i % 3]; }
+        else if (kind == "english") { text[i] = sample[i % sample.size()]; }
+        else { text[i] = (char) (rng() % 256); }
+    }
+    return text;
+}
+
+// a pattern from the corpus' own distribution, planted every `every` bytes (0: only chance hits)
+string plant(string& text, size_t m, size_t every, mt19937_64& rng) {
+    size_t at = rng() % (text.size() - m);
+    string pattern = text.substr(at, m);
+    if (every == 0) { //make it (almost surely) absent: flip a byte the corpus rarely contains
+        pattern[m / 2] = (char) 0xFE;
+        return pattern;
+    }
+    for (size_t i = 0; i + m <= text.size(); i += every) { text.replace(i, m, pattern); }
+    return pattern;
+}
+
+struct Engine {
+    const char* name;
+    // untimed setup for one pattern (the Aho-Corasick build); the returned searcher is what is timed
+    function<function<size_t(string_view)>(const string&)> prepare;
+};
+
+vector<Engine> engines() {
+    vector<Engine> list;
+    auto matcher = [&list](const char* name, Matcher algo) {
+        list.push_back({name, [algo](const string& pattern) {
+            return function<size_t(string_view)>([algo, &pattern](string_view text) { return algo(text, pattern).getHits().size(); });
+        }});
+    };
+    matcher("Naive", Naive);
+    matcher("RabinKarp", RabinKarp);
+    matcher("KnuthMorrisPratt", KnuthMorrisPratt);
+    matcher("BoyerMoore", BoyerMoore);
+    matcher("Horspool", Horspool);
+    matcher("Sunday", Sunday);
+    matcher("SimdFilter", SimdFilter);
+    list.push_back({"AhoCorasick", [](const string& pattern) {
+        auto automaton = make_shared<AhoCorasick>(vector<string> {pattern});
+        return function<size_t(string_view)>([automaton](string_view text) { return automaton->search(text).size(); });
+    }});
+    list.push_back({"Search/context", [](const string& pattern) {
+        return function<size_t(string_view)>([&pattern](string_view text) { return Search(text, pattern, ThreadContext()).size(); });
+    }});
+    list.push_back({"ParallelSearch/Simd", [](const string& pattern) {
+        return function<size_t(string_view)>([&pattern](string_view text) { return ParallelSearch(text, pattern, SimdFilter).size(); });
+    }});
+    return list;
+}
+
+int run(size_t n, string_view sample, const char* file) {
+    mt19937_64 rng(2023);
+    vector<pair<string, string>> corpora;
+    for (const char* kind : {"random", "dna", "periodic", "english", "binary"}) { corpora.emplace_back(kind, corpus(kind, n, sample, rng)); }
+    if (file != nullptr) {
+        MappedFile mapped(file);
+        if (!mapped.mapped()) { cerr << file << ": not mappable\n"; return 1; }
+        corpora.emplace_back("file", string(mapped.text().substr(0, n)));
+    }
+    vector<Engine> list = engines();
+    cout << left << setw(10) << "corpus" << right << setw(6) << "m" << setw(9) << "every" << "  " << left << setw(22) << "engine"
+         << right << setw(10) << "GB/s" << setw(12) << "ns/hit" << setw(10) << "hits" << setw(12) << "allocs" << "\n";
+    for (auto& [kind, base] : corpora) {
+        for (size_t m : {2, 4, 8, 16, 64, 256}) {
+            for (size_t every : {0, 65536, 1024}) {
+                if (m >= base.size() || (every != 0 && every < m)) { continue; }
+                string text = base;
+                string pattern = plant(text, m, every, rng);
+                for (const Engine& e : list) {
+                    function<size_t(string_view)> search = e.prepare(pattern);
+                    size_t hits = 0, reps = 0, before = allocated();
+                    auto t0 = chrono::steady_clock::now();
+                    double seconds = 0;
+                    do { //repeat for at least 0.1s so short runs are not timer noise
+                        hits = search(text);
+                        ++reps;
+                        seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+                    } while (seconds < 0.1 && reps < 100);
+                    double perRun = seconds / (double) reps;
+                    cout << left << setw(10) << kind << right << setw(6) << m << setw(9) << every << "  " << left << setw(22) << e.name
+                         << right << fixed << setprecision(3) << setw(10) << (double) text.size() / perRun / 1e9
+                         << setprecision(1) << setw(12) << ((hits > 0) ? perRun * 1e9 / (double) hits : 0.0)
+                         << setw(10) << hits << setw(12);
+                    if (countsAllocations()) { cout << (double) (allocated() - before) / (double) reps << "\n"; } else { cout << "-\n"; }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+// fastest of f() repeated for at least 20ms, in seconds per call
+template <typename F>
+double timed(F f) {
+    size_t reps = 0;
+    auto t0 = chrono::steady_clock::now();
+    double seconds = 0;
+    do { f(); ++reps; seconds = chrono::duration<double>(chrono::steady_clock::now() - t0).count(); } while (seconds < 0.02);
+    return seconds / (double) reps;
+}
+
+// measures the pattern-length crossover of Choose() on the file (or english text): longPattern is
+// the last power of two before BoyerMoore beats SimdFilter on a non-periodic, absent pattern
+Thresholds calibrate(string_view sample, const char* file) {
+    mt19937_64 rng(2023);
+    string text;
+    if (file != nullptr) {
+        MappedFile mapped(file);
+        text = string(mapped.text().substr(0, 4 << 20));
+    }
+    if (text.size() < (1 << 16)) { text = corpus("english", 4 << 20, sample, rng); }
+    Thresholds t;
+    t.longPattern = 4096;
+    for (size_t m = 8; m <= 4096; m *= 2) {
+        string pattern = plant(text, m, 0, rng);
+        double vec = timed([&] { return SimdFilter(text, pattern).getHits().size(); });
+        double bm = timed([&] { return BoyerMoore(text, pattern).getHits().size(); });
+        if (bm < vec) { t.longPattern = m / 2; break; }
+    }
+    return t;
+}
+
+}
+
+// self test starts here
+// (strings --selftest [rounds]: every engine against Naive, or against a brute-force reference
+// where Naive does not apply, on random texts over tiny alphabets, so hits are dense, patterns
+// periodic and chunk, segment and shard borders cut through matches; prints the first failures
+// and exits with 1 if there were any)
+
+namespace selftest {
+
+int failures = 0;
+
+void expect(bool ok, const char* what, string_view text, string_view pattern) {
+    if (ok) { return; }
+    if (++failures <= 20) {
+        cerr << "selftest: " << what << " failed, pattern \"" << pattern << "\" in \"" << text.substr(0, 200)
+             << ((text.size() > 200) ? "..." : "") << "\" (" << text.size() << " bytes)\n";
+    }
+}
+
+vector<Offset> starts(const vector<Hit>& hits) {
+    vector<Offset> s;
+    for (const Hit& h : hits) { s.push_back(h.start); }
+    return s;
+}
+
+// (start, length, id) of every hit, ordered, for engines that report in some other order
+vector<tuple<Offset, int, int>> keys(const vector<Hit>& hits) {
+    vector<tuple<Offset, int, int>> k;
+    for (const Hit& h : hits) { k.emplace_back(h.start, h.length, h.id); }
+    sort(k.begin(), k.end());
+    return k;
+}
+
+string random(mt19937_64& rng, size_t n, string_view alphabet) {
+    string s(n, '\0');
+    for (char& c : s) { c = alphabet[rng() % alphabet.size()]; }
+    return s;
+}
+
+// a small alphabet, mostly; sometimes bytes that trip signed-char and NUL handling
+string_view alphabet(mt19937_64& rng) {
+    static const string binary("a\0\xff\n", 4);
+    static const string_view small[] = {"ab", "abc", "ACGT", "ab \n", binary};
+    return small[rng() % size(small)];
+}
+
+// half the time a piece of the text itself, so there is at least one hit
+string pattern(mt19937_64& rng, string_view text, size_t m, string_view letters) {
+    if (text.size() >= m && rng() % 2) { return string(text.substr(rng() % (text.size() - m + 1), m)); }
+    return random(rng, m, letters);
+}
+
+size_t length(mt19937_64& rng, size_t limit) { //short ones mostly, a few long enough for every SIMD kernel
+    return 1 + ((rng() % 8 == 0) ? rng() % limit : rng() % 8);
+}
+
+// plain loop, the reference for Naive itself
+vector<Offset> brute(string_view text, string_view p) {
+    vector<Offset> s;
+    for (size_t i = 0; i + p.size() <= text.size(); ++i) { if (text.compare(i, p.size(), p) == 0) { s.push_back((Offset) i); } }
+    return s;
+}
+
+// every SIMD kernel this cpu can run, not only the one dispatch() picks
+template <bool caseless>
+vector<pair<const char*, simd::Kernel>> kernels() {
+    vector<pair<const char*, simd::Kernel>> list;
+    list.emplace_back("scalar", [](string_view base, string_view pattern, const simd::Emit& out) { simd::scalar<caseless>(base, pattern, 0, out); });
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) { list.emplace_back("avx512", simd::avx512<caseless>); }
+    if (__builtin_cpu_supports("avx2")) { list.emplace_back("avx2", simd::avx2<caseless>); }
+    if (__builtin_cpu_supports("sse2")) { list.emplace_back("sse2", simd::sse2<caseless>); }
+#elif defined(__aarch64__)
+    list.emplace_back("neon", simd::neon<caseless>);
+#endif
+    return list;
+}
+
+template <bool caseless>
+void kernels(string_view text, string_view p, const vector<Offset>& want) {
+    for (auto [name, kernel] : kernels<caseless>()) {
+        vector<Offset> got;
+        simd::Emit out {&got, [](void* ctx, Offset s) { static_cast<vector<Offset>*>(ctx)->push_back(s); return true; }};
+        if (!p.empty() && p.size() <= text.size()) { kernel(text, p, out); }
+        expect(got == want, name, text, p);
+    }
+}
+
+// a path of our own in the temporary directory
+string temporary(string_view name) {
+    return (filesystem::temp_directory_path() / ("strings-selftest-" + to_string(getpid()) + "." + string(name))).string();
+}
+
+void save(const string& path, string_view text) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (f == nullptr) { throw system_error(errno, generic_category(), path); }
+    fwrite(text.data(), 1, text.size(), f);
+    fclose(f);
+}
+
+void exact(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, (rng() % 8 == 0) ? rng() % 5000 : rng() % 300, letters);
+    string p = pattern(rng, text, length(rng, 80), letters);
+    vector<Offset> want = starts(Naive(text, p).getHits());
+    expect(want == brute(text, p), "Naive", text, p);
+    for (Algorithm a : {Algorithm::RabinKarp, Algorithm::KnuthMorrisPratt, Algorithm::BoyerMoore, Algorithm::Horspool,
+                        Algorithm::Sunday, Algorithm::SimdFilter}) {
+        expect(starts(MatcherOf(a)(text, p).getHits()) == want, Name(a), text, p);
+        expect(starts(ParallelSearch(text, p, MatcherOf(a), SharedPool(), 16)) == want, "ParallelSearch", text, p);
+    }
+    expect(starts(Search(text, p).getHits()) == want, "Search", text, p);
+    kernels<false>(text, p, want);
+    CompiledPattern<compiled::BoyerMoore> compiled(p);
+    vector<Offset> ranged;
+    for (Hit h : compiled.hits(text)) { ranged.push_back(h.start); }
+    expect(ranged == want, "CompiledPattern::hits", text, p);
+    expect(compiled.count(text) == want.size(), "CompiledPattern::count", text, p);
+    expect(compiled.findFirst(text) == (want.empty() ? -1 : want[0]), "CompiledPattern::findFirst", text, p);
+    Match spaced = SpaceInsensitive(text, p);
+    //reference: Naive over the text with its whitespace runs collapsed, mapped back
+    string collapsed, folded;
+    vector<Offset> at;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (!IsSpace(text[i])) { collapsed += text[i]; at.push_back((Offset) i); }
+        else if (i == 0 || !IsSpace(text[i-1])) { collapsed += ' '; at.push_back((Offset) i); }
+    }
+    for (char c : p) { if (!IsSpace(c)) { folded += c; } else if (folded.empty() || folded.back() != ' ') { folded += ' '; } }
+    vector<tuple<Offset, int, int>> runs;
+    for (Offset s : starts(Naive(collapsed, folded).getHits())) {
+        Offset first = at[(size_t) s], last = at[(size_t) s + folded.size() - 1];
+        runs.emplace_back(first, (int) (last - first + 1), 0);
+    }
+    expect(keys(spaced.getHits()) == runs, "SpaceInsensitive", text, p);
+}
+
+void caseless(mt19937_64& rng) {
+    string text = random(rng, rng() % 400, "aAbB \xc3");
+    string p = pattern(rng, text, length(rng, 70), "aAbB");
+    auto lower = [](string s) { for (char& c : s) { if (c >= 'A' && c <= 'Z') { c = (char) (c - 'A' + 'a'); } } return s; };
+    vector<Offset> want = starts(Naive(lower(text), lower(p)).getHits());
+    expect(starts(CaselessKnuthMorrisPratt(text, p).getHits()) == want, "CaselessKnuthMorrisPratt", text, p);
+    expect(starts(CaselessBoyerMoore(text, p).getHits()) == want, "CaselessBoyerMoore", text, p);
+    expect(starts(CaselessSimdFilter(text, p).getHits()) == want, "CaselessSimdFilter", text, p);
+    expect(starts(SearchCaseless(text, p).getHits()) == want, "SearchCaseless", text, p);
+    kernels<true>(text, p, want);
+}
+
+constexpr FixedString fixed1("a");
+constexpr FixedString fixed2("ab");
+constexpr FixedString fixed3("aab");
+constexpr FixedString fixed4("abab");
+constexpr FixedString fixed5("abcab");
+constexpr FixedString fixed6("aaaaaaaa");
+
+template <const auto& P>
+void fixed(mt19937_64& rng, string_view text) {
+    vector<Offset> want = starts(Naive(text, P.view()).getHits());
+    expect(starts(StaticPattern<P>().search(text).getHits()) == want, "StaticPattern", text, P.view());
+    expect(StaticPattern<P>().count(text) == want.size(), "StaticPattern::count", text, P.view());
+    //in random chunks, twice: finish() starts the next stream at offset 0
+    typename StaticPattern<P>::Stream stream;
+    for (int pass = 0; pass < 2; ++pass, stream.finish()) {
+        vector<Hit> fed;
+        for (size_t i = 0, chunk; i < text.size(); i += chunk) {
+            chunk = 1 + rng() % 12;
+            stream.feed(text.substr(i, chunk), [&](const Hit& h) { fed.push_back(h); });
+        }
+        expect(starts(fed) == want, "StaticPattern::Stream", text, P.view());
+    }
+}
+
+void compileTime(mt19937_64& rng) {
+    string text = random(rng, rng() % 300, "abc");
+    fixed<fixed1>(rng, text);
+    fixed<fixed2>(rng, text);
+    fixed<fixed3>(rng, text);
+    fixed<fixed4>(rng, text);
+    fixed<fixed5>(rng, text);
+    fixed<fixed6>(rng, text);
+}
+
+void streaming(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, rng() % 500, letters);
+    string p = pattern(rng, text, length(rng, 20), letters);
+    vector<Offset> want = starts(Naive(text, p).getHits());
+    StreamKnuthMorrisPratt kmp(p);
+    StreamRabinKarp rk(p);
+    vector<Hit> byKmp, byRk;
+    for (size_t i = 0, chunk; i < text.size(); i += chunk) {
+        chunk = 1 + rng() % 40;
+        string_view piece = string_view(text).substr(i, chunk);
+        for (const Hit& h : kmp.feed(piece)) { byKmp.push_back(h); }
+        for (const Hit& h : rk.feed(piece)) { byRk.push_back(h); }
+    }
+    expect(starts(byKmp) == want, "StreamKnuthMorrisPratt", text, p);
+    expect(starts(byRk) == want, "StreamRabinKarp", text, p);
+}
+
+void incremental(mt19937_64& rng) {
+    string p = random(rng, 1 + rng() % 4, "ab");
+    IncrementalSearch search(p, random(rng, rng() % 50, "ab"));
+    for (int edit = 0; edit < 30; ++edit) {
+        string bytes = random(rng, rng() % 6, "ab");
+        size_t pos = rng() % (search.view().size() + 1);
+        switch (rng() % 3) {
+            case 0: search.append(bytes); break;
+            case 1: search.insert(pos, bytes); break;
+            default: search.replace(pos, rng() % 6, bytes); break;
+        }
+        expect(starts(search.hits()) == starts(Naive(search.view(), p).getHits()), "IncrementalSearch", search.view(), p);
+    }
+}
+
+// fewest edits turning p into a suffix of text[0, end], the Sellers column at end
+vector<int> sellers(string_view text, string_view p) {
+    size_t m = p.size();
+    vector<int> column(m + 1), best;
+    for (size_t i = 0; i <= m; ++i) { column[i] = (int) i; }
+    for (char c : text) {
+        int diagonal = column[0];
+        column[0] = 0; //a match may start anywhere
+        for (size_t i = 1; i <= m; ++i) {
+            int up = column[i];
+            column[i] = min({up + 1, column[i-1] + 1, diagonal + (p[i-1] != c)});
+            diagonal = up;
+        }
+        best.push_back(column[m]);
+    }
+    return best;
+}
+
+int distance(string_view a, string_view b) {
+    vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) { row[j] = (int) j; }
+    for (size_t i = 1; i <= a.size(); ++i) {
+        int diagonal = row[0];
+        row[0] = (int) i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            int up = row[j];
+            row[j] = min({up + 1, row[j-1] + 1, diagonal + (a[i-1] != b[j-1])});
+            diagonal = up;
+        }
+    }
+    return row[b.size()];
+}
+
+void approximate(mt19937_64& rng) {
+    string text = random(rng, rng() % 200, "abc");
+    string p = pattern(rng, text, 1 + rng() % 10, "abc");
+    int m = (int) p.size(), k = (int) (rng() % 4);
+    vector<tuple<Offset, int, int>> want;
+    vector<float> accuracy;
+    for (size_t s = 0; s + p.size() <= text.size(); ++s) {
+        int d = 0;
+        for (size_t i = 0; i < p.size(); ++i) { d += text[s+i] != p[i]; }
+        if (d <= k) { want.emplace_back((Offset) s, m, 0); accuracy.push_back(1.0f - (float) d / (float) m); }
+    }
+    vector<Hit> mismatch = KMismatch(text, p, k).getHits();
+    expect(keys(mismatch) == want, "KMismatch", text, p);
+    for (size_t i = 0; i < mismatch.size() && i < accuracy.size(); ++i) { expect(mismatch[i].accuracy == accuracy[i], "KMismatch accuracy", text, p); }
+    //KEdit: a hit per end within min(k, m-1) edits that is a local minimum of the Sellers column
+    //(below the end before it, or exact, or m past the last hit on a plateau; no worse than the end
+    //after it), spanning a substring that has exactly that many edits to the pattern
+    int budget = min(k, m - 1);
+    vector<int> column = sellers(text, p);
+    vector<Offset> ends;
+    for (size_t j = 0; j < column.size(); ++j) {
+        int before = (j == 0) ? m : column[j-1];
+        bool lower = column[j] < before || column[j] == 0 || ends.empty() || (Offset) j >= ends.back() + m;
+        if (column[j] <= budget && lower && (j + 1 == column.size() || column[j] <= column[j+1])) { ends.push_back((Offset) j); }
+    }
+    vector<Hit> edits = KEdit(text, p, k).getHits();
+    vector<Offset> got;
+    for (const Hit& h : edits) {
+        Offset end = h.start + h.length - 1;
+        got.push_back(end);
+        int best = column[(size_t) end];
+        expect(h.accuracy == 1.0f - (float) best / (float) m, "KEdit accuracy", text, p);
+        expect(distance(string_view(text).substr((size_t) h.start, (size_t) h.length), p) == best, "KEdit start", text, p);
+    }
+    expect(got == ends, "KEdit ends", text, p);
+    //independent of the rule above: every exact occurrence is a hit of its own
+    vector<Offset> exact;
+    for (const Hit& h : edits) { if (h.accuracy == 1.0f) { exact.push_back(h.start); } }
+    expect(exact == brute(text, p), "KEdit exact hits", text, p);
+}
+
+// every top-k path is the head of the full ranking, a huge top included (nothing is reserved for it)
+void topK(mt19937_64& rng) {
+    string text = random(rng, rng() % 200, "abc");
+    string p = pattern(rng, text, 1 + rng() % 8, "abc");
+    int k = (int) (rng() % 4);
+    size_t top = (rng() % 8 == 0) ? (size_t) 1e12 : 1 + rng() % 6;
+    auto ranked = [](const vector<Hit>& hits) {
+        vector<tuple<Offset, int, float>> r;
+        for (const Hit& h : hits) { r.emplace_back(h.start, h.length, h.accuracy); }
+        return r;
+    };
+    auto head = [&](vector<Hit> hits) {
+        sort(hits.begin(), hits.end(), Better);
+        hits.resize(min(hits.size(), top), Hit(0, 0));
+        return ranked(hits);
+    };
+    Match edits = KEdit(text, p, k), mismatches = KMismatch(text, p, k);
+    expect(ranked(KEdit(text, p, k, true, top).getHits()) == head(edits.getHits()), "KEdit top", text, p);
+    expect(ranked(KMismatch(text, p, k, true, top).getHits()) == head(mismatches.getHits()), "KMismatch top", text, p);
+    expect(ranked(Match(text, p, edits.getHits(), true, 5, top).getHits()) == head(edits.getHits()), "Match top", text, p);
+    vector<Offset> want = starts(Naive(text, p).getHits());
+    want.resize(min(want.size(), top));
+    vector<Hit> first;
+    CompiledPattern<compiled::Horspool>(p).findN(text, top, first);
+    expect(starts(first) == want, "CompiledPattern::findN", text, p);
+    expect(starts(FindN(text, p, top)) == want, "FindN", text, p);
+}
+
+void multi(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, rng() % 600, letters);
+    vector<string> patterns, same;
+    size_t count = 1 + rng() % 12, m = 1 + rng() % 5;
+    for (size_t k = 0; k < count; ++k) {
+        string p = pattern(rng, text, length(rng, 30), letters);
+        if (find(patterns.begin(), patterns.end(), p) == patterns.end()) { patterns.push_back(p); }
+        string q = pattern(rng, text, m, letters);
+        if (find(same.begin(), same.end(), q) == same.end()) { same.push_back(q); }
+    }
+    auto reference = [&](const vector<string>& set) {
+        vector<Hit> hits;
+        for (int id = 0; id < (int) set.size(); ++id) {
+            Match found = Naive(text, set[id]);
+            for (const Hit& h : found.getHits()) { hits.emplace_back(h.start, h.length, 1.0f, id); }
+        }
+        return keys(hits);
+    };
+    vector<tuple<Offset, int, int>> want = reference(patterns);
+    string all;
+    for (const string& p : patterns) { all += (all.empty() ? "" : "|") + p; }
+    expect(keys(AhoCorasick(patterns, (int) (rng() % 4)).search(text)) == want, "AhoCorasick", text, all);
+    expect(keys(BulkSearch(text, patterns, Backend::Cpu)) == want, "BulkSearch", text, all);
+    all.clear();
+    for (const string& p : same) { all += (all.empty() ? "" : "|") + p; }
+    expect(keys(RabinKarpSet(same).search(text)) == reference(same), "RabinKarpSet", text, all);
+}
+
+// leftmost-longest, non-overlapping, non-empty, as Wildcard reports them, by std::regex full matches
+void wildcard(mt19937_64& rng) {
+    static const char* atoms[][2] = {{"a", "a"}, {"b", "b"}, {"c", "c"}, {"?", "[^\\n]"}, {"*", "[^\\n]*"},
+                                     {"[ab]", "[ab]"}, {"[^a]", "[^a]"}, {"[a-b]", "[a-b]"}, {"(a|bc)", "(?:a|bc)"},
+                                     {"(b|a*c)", "(?:b|a[^\\n]*c)"}, {"\\*", "\\*"}};
+    string pattern, expression;
+    int items = 1 + (int) (rng() % 4);
+    for (int k = 0; k < items; ++k) {
+        const char** atom = atoms[rng() % size(atoms)];
+        pattern += atom[0];
+        expression += atom[1];
+    }
+    if (rng() % 4 == 0) { pattern += "|ab"; expression += "|ab"; }
+    string text = random(rng, rng() % 120, "abc*\n");
+    regex reference(expression);
+    vector<Hit> want;
+    for (size_t s = 0; s < text.size(); ) {
+        size_t best = 0;
+        for (size_t l = 1; s + l <= text.size(); ++l) { if (regex_match(text.begin() + (long) s, text.begin() + (long) (s + l), reference)) { best = l; } }
+        if (best == 0) { ++s; continue; }
+        want.emplace_back((Offset) s, (int) best);
+        s += best;
+    }
+    expect(keys(Wildcard(pattern).search(text).getHits()) == keys(want), "Wildcard", text, pattern);
+}
+
+// HitStore keeps 64-bit starts whole, also past 2^31 and 2^32
+void compact(mt19937_64& rng) {
+    string text = random(rng, rng() % 400, "ab");
+    string p = pattern(rng, text, 1 + rng() % 3, "ab");
+    vector<Offset> want = starts(Naive(text, p).getHits());
+    HitStore store = Compact(CompiledPattern<compiled::KnuthMorrisPratt>(p), text);
+    expect(starts(store.hits()) == want, "Compact", text, p);
+    HitStore far((int) p.size());
+    vector<Offset> wide;
+    for (Offset s = 0, k = 0; k < 600; ++k) {
+        s += (k % 100 == 0) ? (Offset) (3ULL << 31) + (Offset) (rng() % (1ULL << 33)) : (Offset) (rng() % 300);
+        far.push((uint64_t) s);
+        wide.push_back(s);
+    }
+    bool seeks = true;
+    for (size_t k = 0; k < wide.size(); k += 1 + rng() % 50) { seeks = seeks && far.at(k) == (uint64_t) wide[k]; }
+    expect(starts(far.hits()) == wide && seeks, "HitStore past 2^31", text, p);
+}
+
+// SearchFile over the mapped file and over the chunked read() fallback of a fifo, in tiny chunks
+// so that most matches straddle one
+void file(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, rng() % 400, letters);
+    string p = pattern(rng, text, length(rng, 20), letters);
+    vector<Offset> want = starts(Naive(text, p).getHits());
+    Matcher algo = MatcherOf((rng() % 2) ? Algorithm::KnuthMorrisPratt : Algorithm::SimdFilter);
+    size_t chunk = 1 + rng() % 16;
+    string path = temporary("file");
+    save(path, text);
+    expect(starts(SearchFile(path.c_str(), p, algo, chunk)) == want, "SearchFile", text, p);
+    remove(path.c_str());
+    if (mkfifo(path.c_str(), 0600) != 0) { throw system_error(errno, generic_category(), path); }
+    thread writer([&] { //open() blocks until SearchFile opens the other end
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        for (size_t i = 0; fd >= 0 && i < text.size(); i += 64) { (void) !write(fd, text.data() + i, min<size_t>(64, text.size() - i)); }
+        if (fd >= 0) { close(fd); }
+    });
+    vector<Hit> piped = SearchFile(path.c_str(), p, algo, chunk);
+    writer.join();
+    remove(path.c_str());
+    expect(starts(piped) == want, "SearchFile (fifo)", text, p);
+}
+
+// SearchFiles over a few temporary files with tiny blocks and few buffers, so chunks straddle
+// matches and the reader waits on the ring; then with an unreadable file last, and with a visitor
+// that throws, both of which must stop the pipeline and reach the caller
+void files(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string p = random(rng, length(rng, 12), letters);
+    vector<string> paths;
+    vector<tuple<size_t, Offset>> want;
+    for (size_t f = 0, count = rng() % 4; f < count; ++f) {
+        string text = random(rng, (rng() % 4 == 0) ? 0 : rng() % 600, letters);
+        for (Offset s : starts(Naive(text, p).getHits())) { want.emplace_back(f, s); }
+        paths.push_back(temporary("files" + to_string(f)));
+        save(paths.back(), text);
+    }
+    size_t block = 1 + rng() % 64;
+    int buffers = 2 + (int) (rng() % 4);
+    vector<tuple<size_t, Offset>> got;
+    auto collect = [&](size_t f, const Hit& h) { got.emplace_back(f, h.start); };
+    SearchFiles(paths, p, collect, block, buffers);
+    expect(got == want, "SearchFiles", "", p);
+    vector<string> missing = paths;
+    missing.push_back(temporary("missing"));
+    got.clear();
+    bool thrown = false;
+    try { SearchFiles<compiled::KnuthMorrisPratt>(missing, p, collect, block, buffers); }
+    catch (const system_error&) { thrown = true; }
+    expect(thrown && got == want, "SearchFiles (unreadable file)", "", p);
+    thrown = false;
+    try { SearchFiles(paths, p, [](size_t, const Hit&) { throw runtime_error("stop"); }, block, buffers); }
+    catch (const runtime_error&) { thrown = true; }
+    expect(thrown == !want.empty(), "SearchFiles (visitor throws)", "", p);
+    for (const string& path : paths) { remove(path.c_str()); }
+}
+
+// HitWriter through a small buffer into a temporary file, against the same lines built with string
+void writer(mt19937_64& rng) {
+    string text = random(rng, rng() % 300, "ab\n");
+    string p = pattern(rng, text, 1 + rng() % 3, "ab");
+    size_t context = rng() % 8;
+    string want;
+    FILE* file = tmpfile();
+    if (file == nullptr) { throw system_error(errno, generic_category(), "tmpfile"); }
+    {
+        HitWriter out(fileno(file), 64 + rng() % 64); //a line may be longer than the buffer
+        for (Offset s : starts(Naive(text, p).getHits())) {
+            size_t start = (size_t) s, end = start + p.size();
+            size_t from = start - min(start, context), to = min(text.size(), end + context);
+            size_t nl = text.rfind('\n', start == 0 ? 0 : start - 1);
+            if (start > 0 && nl != string::npos && nl >= from) { from = nl + 1; }
+            to = min(to, text.find('\n', end));
+            string label = "f" + to_string(rng() % 3);
+            out.line(label, text, start, p.size(), context);
+            out.offset(label, start);
+            want += label + ":" + to_string(start) + ((from > 0 && text[from-1] != '\n') ? ":..." : ":") +
+                    text.substr(from, start - from) + "<" + p + ">" + text.substr(end, to - end) +
+                    ((to < text.size() && text[to] != '\n') ? "...\n" : "\n");
+            want += label + ":" + to_string(start) + "\n";
+        }
+    }
+    string got;
+    rewind(file);
+    for (int c; (c = fgetc(file)) != EOF; ) { got += (char) c; }
+    fclose(file);
+    expect(got == want, "HitWriter", text, p);
+}
+
+// both SearchBatch() forms against Naive per record, a buffer with a prefix before the first record
+void batch(mt19937_64& rng) {
+    string p = random(rng, 1 + rng() % 3, "ab");
+    string buffer = random(rng, rng() % 10, "ab");
+    vector<Offset> offsets {(Offset) buffer.size()};
+    vector<string_view> records;
+    vector<tuple<Offset, int, int>> want; //(record, start, 0)
+    for (size_t r = 0, count = rng() % 30; r < count; ++r) {
+        string record = random(rng, rng() % 12, "ab");
+        for (Offset s : starts(Naive(record, p).getHits())) { want.emplace_back((Offset) r, (int) s, 0); }
+        buffer += record;
+        offsets.push_back((Offset) buffer.size());
+    }
+    for (size_t r = 0; r + 1 < offsets.size(); ++r) { records.push_back(string_view(buffer).substr((size_t) offsets[r], (size_t) (offsets[r+1] - offsets[r]))); }
+    auto columns = [](const BatchHits& hits) {
+        vector<tuple<Offset, int, int>> k;
+        for (size_t i = 0; i < hits.size(); ++i) { k.emplace_back((Offset) hits.record[i], (int) hits.start[i], hits.id[i]); }
+        return k;
+    };
+    BatchHits joined, apart, set;
+    SearchBatch(buffer, offsets, CompiledPattern<compiled::SimdFilter>(p), joined);
+    SearchBatch(records, CompiledPattern<compiled::KnuthMorrisPratt>(p), apart);
+    SearchBatch(buffer, offsets, AhoCorasick({p}), set);
+    expect(columns(joined) == want, "SearchBatch", buffer, p);
+    expect(columns(apart) == want, "SearchBatch (records)", buffer, p);
+    expect(columns(set) == want, "SearchBatch (AhoCorasick)", buffer, p);
+}
+
+// one SearchContext across queries, its arena handing out aligned blocks before and after it spills
+void context(mt19937_64& rng) {
+    Arena arena(1 + rng() % 200);
+    bool aligned = true;
+    for (int round = 0; round < 2; ++round, arena.reset()) {
+        for (int k = 0; k < 20; ++k) {
+            size_t align = size_t(1) << (rng() % 7);
+            auto p = (uintptr_t) arena.allocate(1 + rng() % 40, align);
+            aligned = aligned && p % align == 0;
+        }
+    }
+    expect(aligned, "Arena alignment", "", "");
+    static SearchContext ctx(16); //tiny, so the tables spill and the next begin() regrows it
+    string_view letters = alphabet(rng);
+    string text = random(rng, rng() % 300, letters);
+    for (int q = 0; q < 3; ++q) {
+        string p = pattern(rng, text, length(rng, 40), letters);
+        vector<Offset> want = starts(Naive(text, p).getHits());
+        expect(starts(SearchWith<compiled::KnuthMorrisPratt>(text, p, ctx)) == want, "SearchWith (context)", text, p);
+        expect(starts(SearchWith<compiled::BoyerMoore>(text, p, ctx)) == want, "SearchWith (context)", text, p);
+        expect(starts(Search(text, p, ThreadContext())) == want, "Search (context)", text, p);
+    }
+}
+
+void indexes(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, rng() % 1000, letters);
+    SuffixArray index(text);
+    FMIndex compressed(text, 1 + (int) (rng() % 40));
+    for (int q = 0; q < 8; ++q) {
+        string p = pattern(rng, text, length(rng, 40), letters);
+        vector<Offset> want = starts(Naive(text, p).getHits());
+        expect(starts(index.search(p).getHits()) == want, "SuffixArray", text, p);
+        expect(index.count(p) == (int) want.size(), "SuffixArray::count", text, p);
+        expect(starts(compressed.search(p)) == want, "FMIndex", text, p);
+        expect(compressed.count(p) == (int) want.size(), "FMIndex::count", text, p);
+        ShardedCorpus raw(text, false, 64, 1 + (int) (rng() % 5)), sharded(text, true, 64, 1 + (int) (rng() % 5));
+        expect(starts(raw.search(p)) == want, "ShardedCorpus", text, p);
+        expect(starts(sharded.search(p)) == want, "ShardedCorpus (indexed)", text, p);
+    }
+    string path = temporary("sa");
+    index.save(path.c_str());
+    SuffixArray loaded = SuffixArray::load(path.c_str());
+    remove(path.c_str());
+    string p = pattern(rng, text, 1 + rng() % 4, letters);
+    expect(starts(loaded.search(p).getHits()) == starts(Naive(text, p).getHits()), "SuffixArray::load", text, p);
+}
+
+// ShardedCorpus save() and load() round trips, raw and indexed, then each way of breaking the
+// directory that load() must refuse with runtime_error
+void shards(mt19937_64& rng) {
+    string_view letters = alphabet(rng);
+    string text = random(rng, 1 + rng() % 800, letters);
+    string dir = temporary("shards");
+    for (bool indexed : {false, true}) {
+        ShardedCorpus saved(text, indexed, 16, 1 + (int) (rng() % 5));
+        saved.save(dir);
+        ShardedCorpus loaded = ShardedCorpus::load(dir);
+        expect(loaded.size() == text.size() && loaded.shardCount() == saved.shardCount(), "ShardedCorpus::load", text, "");
+        for (int q = 0; q < 4; ++q) {
+            string p = pattern(rng, text, 1 + rng() % 16, letters);
+            expect(starts(loaded.search(p)) == starts(Naive(text, p).getHits()), "ShardedCorpus::load", text, p);
+        }
+        string manifest;
+        {
+            MappedFile file((dir + "/manifest").c_str());
+            manifest = string(file.text());
+        }
+        string first = indexed ? "shard-0.sa" : "shard-0.txt";
+        switch (rng() % 4) {
+        case 0: save(dir + "/manifest", manifest.substr(0, rng() % (manifest.rfind(' ') + 1))); break; //torn
+        case 1: save(dir + "/manifest", "shards v2" + manifest.substr(9)); break;
+        case 2: { //more bytes in the shards than in the corpus
+            size_t bytes = manifest.find(' ', manifest.find(' ', 10) + 1) + 1, count = manifest.find(' ', bytes);
+            save(dir + "/manifest", manifest.substr(0, bytes) + "0" + manifest.substr(count));
+            break;
+        }
+        default: save(dir + "/" + first, "x"); break; //a shard that does not match
+        }
+        bool refused = false;
+        try { ShardedCorpus::load(dir); } catch (const runtime_error&) { refused = true; }
+        expect(refused, "ShardedCorpus::load (corrupt)", manifest, "");
+        filesystem::remove_all(dir);
+    }
+}
+
+int run(int rounds) {
+    mt19937_64 rng(2023);
+    for (int r = 0; r < rounds; ++r) {
+        exact(rng);
+        caseless(rng);
+        compileTime(rng);
+        streaming(rng);
+        incremental(rng);
+        approximate(rng);
+        topK(rng);
+        multi(rng);
+        wildcard(rng);
+        compact(rng);
+        file(rng);
+        writer(rng);
+        batch(rng);
+        context(rng);
+        if (r % 4 == 0) { files(rng); }
+        if (r % 8 == 0) { indexes(rng); shards(rng); }
+    }
+    cout << "selftest: " << rounds << " rounds, " << failures << " failures\n";
+    return failures;
+}
+
+}
+
+#ifdef STRINGS_ALLOCS
+//kept out of line: inlined into callers, gcc would pair the malloc()/free() against new/delete
+__attribute__((noinline)) void* operator new(size_t size) {
+    bench::allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(size > 0 ? size : 1)) { return p; }
+    throw bad_alloc();
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { free(p); }
+#endif
+
+int main(int argc, char** argv) {
+    string x = "queLorem ipsum dolor sit amet, consectetur adipiscing elit. Morbi pellentesque rutrum mauris a pretium. Duis sodales vitae lorem id vulputate. Nullam vitae dui interdum, sollicitudin urna quis, mollis ligula. Vestibulum ante ipsum primis in faucibus orci luctus et ultrices posuere cubilia curae; Vestibulum turpis augue, cursus vel mi non, dictum convallis metus. Nunc et leo efficitur, auctor est in, porttitor libero. Ut vulputate cursus condimentum.\n"
+               "Vestibulum sit amet fermentum lorem, at dictum nunc. Aliquam scelerisque condimentum massa a blandit. Vestibulum eu velit sagittis, tincidunt dolor ac, iaculis lacus. Integer quis varius ligula. Lorem ipsum dolor sit amet, consectetur adipiscing elit. Suspendisse ut fermentum libero, at pretium nisl. Pellentesque consectetur mi tortor, id elementum felis eleifend eu. Duis vehicula eget sapien eget ultrices. Ut sem lectus, pulvinar ac est sed, rutrum mattis purus. Duis ultricies enim accumsan ante finibus suscipit. Ut consectetur velit a eros commodo, sed iaculis neque vulputate. Nulla venenatis rhoncus porttitor. Pellentesque blandit venenatis felis, eleifend consequat mauris consectetur a. Praesent eget vulputate sapien. Sed rutrum cursus lectus id consequat.\n"
+               "In ac tortor at odio ornare posuere. Mauris gravida neque a diam sodales tempor. Quisque pellentesque lacus nisi, ac fermentum lacus rhoncus vel. Sed ac viverra orci. Lorem ipsum dolor sit amet, consectetur adipiscing elit. Vivamus in convallis nulla. Nam faucibus nisi nec posuere pulvinar. Maecenas fringilla quam in ultricies scelerisque. Proin ac mi et ex malesuada dictum. Nullam tincidunt leo lacus, et porta sapien cursus porta. Orci varius natoque penatibus et magnis dis parturient montes, nascetur ridiculus mus.\n"
+               "Mauris ultrices vel sem vel laoreet. Phasellus lacus nisl, tincidunt vel libero et, semper pharetra libero. Fusce augue diam, tristique ac blandit quis, finibus vel mi. Curabitur at dolor pretium ex ornare posuere. Mauris egestas eros neque, sit amet tempor sem ornare sed. Pellentesque turpis mi, tincidunt ut efficitur sed, feugiat sit amet magna. Maecenas quam lectus, iaculis nec elit non, vehicula convallis tortor. Aliquam viverra efficitur molestie. Fusce pulvinar ac odio sit amet dignissim. In vitae risus feugiat, convallis turpis a, ullamcorper leo. Donec ornare leo justo, ut interdum neque sodales sed. Donec elit nisi, congue eu metus quis, condimentum egestas orci. Nam eget sem nibh.\n"
+               "Nullam vitae enim ut odio ornare maximus. Aliquam malesuada felis ex, sed tristique diam egestas vel. Ut ac egestas elit, sed condimentum est. Suspendisse potenti. Fusce feugiat dictum lacus at lobortis. Sed consectetur nunc id pretium vestibulum. Morbi viverra mauris et dapibus mattis. Donec ultricies augue tincidunt mauris dignissim, ac commodo mauris suscipitque.";
+    string y = "que";
+//    string x = "Sampletextsamplestringsample.";
+//    string y = "ampl";
+    if (argc > 1 && string_view(argv[1]) == "--calibrate") { //strings --calibrate [file]
+        Thresholds t = bench::calibrate(x, (argc > 2) ? argv[2] : nullptr);
+        cout << "longPattern = " << t.longPattern << "\n";
+        return 0;
+    }
+    if (argc > 1 && string_view(argv[1]) == "--bench") { //strings --bench [bytes] [file]
+        return bench::run((argc > 2) ? stoul(argv[2]) : 4 << 20, x, (argc > 3) ? argv[3] : nullptr);
+    }
+    if (argc >= 2 && argc <= 3 && string_view(argv[1]) == "--selftest") { //strings --selftest [rounds]
+        return selftest::run((argc > 2) ? stoi(argv[2]) : 2000) == 0 ? 0 : 1;
+    }
+    if (argc == 4 && string_view(argv[1]) == "--index") { //strings --index <corpus> <index>
+        try {
+            MappedFile corpus(argv[2]);
+            SuffixArray(corpus.text()).save(argv[3]);
+        } catch (const exception& e) { cerr << e.what() << "\n"; return 1; }
+        return 0;
+    }
+    if (argc >= 4 && argc <= 5 && string_view(argv[1]) == "--shard") { //strings --shard <corpus> <directory> [shards]
+        try {
+            MappedFile corpus(argv[2]);
+            ShardedCorpus(corpus.text(), true, 1 << 12, (argc == 5) ? stoi(argv[4]) : 0).save(argv[3]);
+        } catch (const exception& e) { cerr << e.what() << "\n"; return 1; }
+        return 0;
+    }
+    if (argc > 3 && string_view(argv[1]) == "--grep") { //strings --grep <pattern> <file or directory>...: print file:offset
+        try {
+            vector<string> files = ListFiles(vector<string>(argv + 3, argv + argc));
+            HitWriter out;
+            SearchFiles(files, argv[2], [&](size_t f, const Hit& h) { out.offset(files[f], (uint64_t) h.start); });
+        } catch (const exception& e) { cerr << e.what() << "\n"; return 1; }
+        return 0;
+    }
+    if (argc > 3 && string_view(argv[1]) == "--query") { //strings --query <index or shard directory> <pattern>...: print pattern:offset
+        try {
+            HitWriter out;
+            if (filesystem::is_directory(argv[2])) {
+                ShardedCorpus shards = ShardedCorpus::load(argv[2]);
+                for (int q = 3; q < argc; ++q) {
+                    for (const Hit& h : shards.search(argv[q])) { out.offset(argv[q], (uint64_t) h.start); }
+                }
+                return 0;
+            }
+            SuffixArray index = SuffixArray::load(argv[2]);
+            for (int q = 3; q < argc; ++q) {
+                Match found = index.search(argv[q]);
+                for (const Hit& h : found.getHits()) { out.offset(argv[q], (uint64_t) h.start); }
+            }
+        } catch (const exception& e) { cerr << e.what() << "\n"; return 1; }
+        return 0;
+    }
+    if (argc > 2) { //strings <pattern> <file>...: print file:offset of every hit
+        int status = 0;
+        for (int f = 2; f < argc; ++f) {
+            try {
+                for (const Hit& h : SearchFile(argv[f], argv[1])) { cout << argv[f] << ":" << h.start << "\n"; }
+            } catch (const system_error& e) { cerr << e.what() << "\n"; status = 1; }
+        }
+        return status;
+    }
+    Match naive = Naive(x, y);
+    Match rk = RabinKarp(x, y);
+    Match kmp = KnuthMorrisPratt(x, y);
+    Match bm = BoyerMoore(x, y);
+    Match vec = SimdFilter(x, y);
+    Plan plan;
+    Match any = Search(x, y, Thresholds(), &plan);
+    Match fuzzy = KEdit(x, "vulputatte", 2, true, 5);
+    Match caseless = SearchCaseless(x, "LOREM IPSUM");
+    static constexpr FixedString marker("dolor");
+    Match fixed = StaticPattern<marker>().search(x);
+    Wildcard wildcard("(Lorem|ipsum) ?olor");
+    Match wild = wildcard.search(x);
+    AhoCorasick dictionary({"que", "Lorem", "ipsum"});
+    Match ac = {x, "que|Lorem|ipsum", dictionary.search(x)};
+    Match bulk = {x, "que|Lorem|ipsum", BulkSearch(x, {"que", "Lorem", "ipsum"})};
+    SuffixArray index(x);
+    Match indexed = index.search(y);
+    FMIndex compressed(x, 8);
+    vector<Offset> lines {0}; //the paragraphs as records of one buffer
+    for (size_t i = 0; i < x.size(); ++i) { if (x[i] == '\n') { lines.push_back((Offset) i + 1); } }
+    lines.push_back((Offset) x.size());
+    BatchHits batch;
+    SearchBatch(x, lines, CompiledPattern<compiled::SimdFilter>(y), batch);
+    Match fm = {x, y, compressed.search(y)};
+    ShardedCorpus sharded(x, false, 64, 3);
+    Match shard = {x, y, sharded.search(y)};
+    cout << "Naive:\n" << naive << "\n";
+    cout << "Rabin-Karp:\n" << rk << "\n";
+    cout << "Knuth-Morris-Pratt:\n" << kmp << "\n";
+    cout << "Boyer-Moore:\n" << bm << "\n";
+    cout << "SIMD first/last-byte filter:\n" << vec << "\n";
+    cout << "Search, " << plan << ":\n" << any << "\n";
+    cout << "Aho-Corasick:\n" << ac << "\n";
+    cout << "Bulk search on the " << (GpuAvailable() ? "GPU" : "CPU") << ":\n" << bulk << "\n";
+    cout << "Myers (k=2 edits):\n" << fuzzy << "\n";
+    cout << "Case-insensitive:\n" << caseless << "\n";
+    cout << "Compile-time pattern:\n" << fixed << "\n";
+    cout << "Wildcard:\n" << wild << "\n";
+    cout << "Batch over " << lines.size()-1 << " paragraphs:";
+    for (size_t k = 0; k < batch.size(); ++k) { cout << " " << batch.record[k] << ":" << batch.start[k]; }
+    cout << "\n\n";
+    cout << "Suffix array:\n" << indexed << "\n";
+    cout << "FM-index (" << compressed.bytes() << " bytes for " << x.size() << "):\n" << fm << "\n";
+    cout << "Sharded (" << sharded.shardCount() << " shards on " << numa::nodes().size() << " NUMA nodes):\n" << shard << "\n";
+    StreamKnuthMorrisPratt skmp(y);
+    vector<Hit> streamed;
+    for (size_t i = 0; i < x.size(); i += 64) { //fixed-size chunks, as read from a socket
+        for (const Hit& h : skmp.feed(string_view(x).substr(i, 64))) { streamed.push_back(h); }
+    }
+    skmp.finish();
+    Match stream = {x, y, streamed};
+    cout << "Streaming Knuth-Morris-Pratt (64-byte chunks):\n" << stream << "\n";
+    IncrementalSearch tail(y);
+    for (size_t i = 0; i < x.size(); i += 64) { tail.append(string_view(x).substr(i, 64)); }
+    tail.replace(0, 3, "QUE"); //edits the first hit away
+    Match incremental = tail.search();
+    cout << "Incremental (appended in 64-byte chunks, then the first hit edited):\n" << incremental << "\n";
+#ifdef STRINGS_STATS
+    cout << stats::prometheus();
+#endif
     return 0;
 }